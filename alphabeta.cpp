@@ -0,0 +1,323 @@
+// alphabeta.cpp
+
+#include "alphabeta.h"
+#include "gamestate.h"
+
+#include <cstdlib>
+
+#include <algorithm>
+#include <thread>
+
+namespace pentago
+{
+    // beyond any score
+    static const int infinite = win_score+1;
+
+    // scores this close to a win are wins, whatever the evaluation
+    static const int won = win_score - 6*6;
+
+    // the first window about the last iteration's score, widened to infinite on failing
+    static const int aspiration_window = 25;
+
+    // wins are stored as plies from the position, not from the root
+    static int to_table( int score, int ply )
+    {
+        return (score>=won) ? score+ply : (score<=-won) ? score-ply : score;
+    }
+
+    static int from_table( int score, int ply )
+    {
+        return (score>=won) ? score-ply : (score<=-won) ? score+ply : score;
+    }
+
+    uint64_t alphabeta_search::entry::pack() const
+    {
+        return (uint64_t)(uint16_t)mScore
+            | ((uint64_t)mDepth << 16)
+            | ((uint64_t)mBound << 24)
+            | ((uint64_t)mMove << 32)
+            | ((uint64_t)mGeneration << 48);
+    }
+
+    alphabeta_search::entry alphabeta_search::entry::unpack( uint64_t data )
+    {
+        entry e;
+        e.mScore = (int16_t)(data & 0xffff);
+        e.mDepth = (int)((data >> 16) & 0xff);
+        e.mBound = (bound)((data >> 24) & 3);
+        e.mMove = (uint16_t)(data >> 32);
+        e.mGeneration = (uint16_t)(data >> 48);
+        return e;
+    }
+
+    alphabeta_search::alphabeta_search( size_t bytes, int threads )
+        : mTable(bytes)
+        , mGeneration(0)
+        , mTimeOut(0)
+        , mStop(false)
+        , mDepth(0)
+        , mScore(0)
+    {
+        if (threads<=0) threads = std::max( 1u, std::thread::hardware_concurrency() );
+        mWorkers.resize( threads );
+        for (int t=0;t!=threads;++t)
+        {
+            mWorkers[t].mId = t;
+            mWorkers[t].mRandom = mcts::Random( 2463534242u + t );
+        }
+        clear();
+    }
+
+    void alphabeta_search::clear()
+    {
+        mTable.clear();
+        for (size_t t=0;t!=mWorkers.size();++t)
+        {
+            memset( mWorkers[t].mHasKiller, 0, sizeof(mWorkers[t].mHasKiller) );
+            memset( mWorkers[t].mHistory, 0, sizeof(mWorkers[t].mHistory) );
+        }
+    }
+
+    uint64_t alphabeta_search::nodes() const
+    {
+        uint64_t n = 0;
+        for (size_t t=0;t!=mWorkers.size();++t)
+            n += mWorkers[t].mNodes;
+        return n;
+    }
+
+    bool alphabeta_search::probe( uint64_t key, entry* e ) const
+    {
+        uint64_t data;
+        if (mTable.probe(key, &data)==false) return false;
+
+        *e = entry::unpack(data);
+        return e->mBound!=unused;
+    }
+
+    void alphabeta_search::store( uint64_t key, const entry& e )
+    {
+        // depth preferred replacement by slot, whichever positions share it:
+        // an entry from this search is only replaced by one searched at least as deep,
+        // an earlier search's entry always is, and a race between threads only loses one of their entries
+        const entry held = entry::unpack( mTable.held(key) );
+        if (held.mBound!=unused && held.mGeneration==mGeneration && held.mDepth>e.mDepth)
+            return;
+
+        mTable.store( key, e.pack() );
+    }
+
+    void alphabeta_search::order( worker& w, const move* moves, int n, int ply, const entry* e, int* scores ) const
+    {
+        // the table's move, then the killers, ahead of any history
+        static const int first = 1 << 30;
+        static const int killer = 1 << 29;
+        for (int i=0;i!=n;++i)
+        {
+            const uint16_t packed = moves[i].pack();
+            if (e && e->mMove==packed)
+                scores[i] = first;
+            else if (w.mHasKiller[ply][0] && w.mKillers[ply][0].pack()==packed)
+                scores[i] = killer+1;
+            else if (w.mHasKiller[ply][1] && w.mKillers[ply][1].pack()==packed)
+                scores[i] = killer;
+            else
+            {
+                scores[i] = w.mHistory[ moves[i].mP.get() ][ moves[i].mR.get() ];
+
+                // helpers shuffle moves of similar history
+                if (w.mId)
+                    scores[i] += w.mRandom(16);
+            }
+        }
+    }
+
+    int alphabeta_search::negamax( worker& w, const board& b, const line_counts& counts, int turn, int depth, int ply,
+        int alpha, int beta )
+    {
+        ++w.mNodes;
+        if (mStop.load( std::memory_order_relaxed )) return 0;
+        if (w.mId==0 && (*mTimeOut)()==false)
+        {
+            mStop = true;
+            return 0;
+        }
+
+        const state us = turntostate(turn);
+        const state them = turntostate(turn+1);
+
+        // an open four is an immediate win for the side to move, the placement completing it skips the rotation,
+        // the root still searches its moves, to have one to play
+        if (ply>0)
+        {
+            for (UInt l=0;l!=line_count;++l)
+            {
+                if (counts.count(l, us)==line_length-1 && counts.count(l, them)==0)
+                    return win_score - ply;
+            }
+            if (depth==0)
+                return counts.evaluate(us);
+        }
+
+        const uint64_t key = pack(b);
+        entry held;
+        const entry* hit = probe(key, &held) ? &held : 0;
+        if (hit && ply>0 && hit->mDepth>=depth)
+        {
+            const int score = from_table(hit->mScore, ply);
+            if (hit->mBound==exact ||
+                (hit->mBound==lower && score>=beta) ||
+                (hit->mBound==upper && score<=alpha))
+                return score;
+        }
+
+        move moves[max_moves];
+        int scores[max_moves];
+        const int n = (int)(all_moves(b, turn, moves) - moves);
+        order(w, moves, n, ply, hit, scores);
+
+        const int original = alpha;
+        int best = -infinite;
+        move best_move = moves[0];
+        for (int i=0;i!=n;++i)
+        {
+            // the best of the rest first, as a cutoff usually comes long before the moves run out
+            int next = i;
+            for (int j=i+1;j!=n;++j)
+                if (scores[j]>scores[next]) next = j;
+            std::swap(moves[i], moves[next]);
+            std::swap(scores[i], scores[next]);
+            const move& m = moves[i];
+
+            board after = b;
+            state winner = empty;
+            m.apply(&after, turn, &winner);
+
+            int score;
+            if (winner!=empty || turn+1==6*6)
+            {
+                score = (winner==us) ? win_score - ply
+                    : (winner==them) ? -(win_score - ply)
+                    : 0;
+            }
+            else
+            {
+                line_counts next_counts(counts);
+                next_counts.apply(m, us, after);
+
+                // the first move with the full window, the rest only to show they're no better
+                if (i==0)
+                    score = -negamax(w, after, next_counts, turn+1, depth-1, ply+1, -beta, -alpha);
+                else
+                {
+                    score = -negamax(w, after, next_counts, turn+1, depth-1, ply+1, -alpha-1, -alpha);
+                    if (score>alpha && score<beta)
+                        score = -negamax(w, after, next_counts, turn+1, depth-1, ply+1, -beta, -alpha);
+                }
+            }
+            if (mStop.load( std::memory_order_relaxed )) return 0;
+
+            if (score>best)
+            {
+                best = score;
+                best_move = m;
+                if (ply==0) w.mRootBest = m;
+            }
+            if (score>alpha) alpha = score;
+            if (alpha>=beta)
+            {
+                if (w.mHasKiller[ply][0]==false || w.mKillers[ply][0].pack()!=m.pack())
+                {
+                    w.mKillers[ply][1] = w.mKillers[ply][0];
+                    w.mHasKiller[ply][1] = w.mHasKiller[ply][0];
+                    w.mKillers[ply][0] = m;
+                    w.mHasKiller[ply][0] = true;
+                }
+                w.mHistory[ m.mP.get() ][ m.mR.get() ] += depth*depth;
+                break;
+            }
+        }
+
+        entry e;
+        e.mScore = to_table(best, ply);
+        e.mDepth = depth;
+        e.mBound = (best<=original) ? upper : (best>=beta) ? lower : exact;
+        e.mMove = best_move.pack();
+        e.mGeneration = mGeneration;
+        store(key, e);
+        return best;
+    }
+
+    void alphabeta_search::iterate( worker& w, const board& b, int turn, int max_depth )
+    {
+        const line_counts counts(b);
+
+        // half the helpers a ply ahead of the main thread
+        for (int depth=1+(w.mId&1); depth<=max_depth; ++depth)
+        {
+            int alpha = -infinite, beta = infinite;
+            if (w.mDepth>0)
+            {
+                alpha = std::max( w.mScore-aspiration_window, -infinite );
+                beta = std::min( w.mScore+aspiration_window, infinite );
+            }
+
+            int score;
+            for (;;)
+            {
+                score = negamax(w, b, counts, turn, depth, 0, alpha, beta);
+                if (mStop) return;
+                if (score<=alpha) alpha = -infinite;
+                else if (score>=beta) beta = infinite;
+                else break;
+            }
+
+            w.mBest = w.mRootBest;
+            w.mDepth = depth;
+            w.mScore = score;
+
+            // nothing deeper changes a proven result
+            if (std::abs(score)>=won) return;
+        }
+    }
+
+    move alphabeta_search::search( const board& b, int turn, const timeout_fn& timeOut, int max_depth )
+    {
+        mTimeOut = &timeOut;
+        mStop = false;
+        ++mGeneration;
+
+        // any move, should the first iteration not finish
+        move moves[max_moves];
+        all_moves(b, turn, moves);
+
+        // the killers were for other positions, and the history is halved, to favour this search's cutoffs
+        for (size_t t=0;t!=mWorkers.size();++t)
+        {
+            worker& w = mWorkers[t];
+            memset( w.mHasKiller, 0, sizeof(w.mHasKiller) );
+            for (UInt p=0;p!=6*6;++p)
+                for (UInt r=0;r!=8;++r)
+                    w.mHistory[p][r] /= 2;
+            w.mNodes = 0;
+            w.mDepth = 0;
+            w.mScore = 0;
+            w.mBest = moves[0];
+        }
+
+        max_depth = std::min( max_depth, 6*6-turn );
+        std::vector< std::thread > helpers;
+        for (size_t t=1;t<mWorkers.size();++t)
+            helpers.push_back( std::thread( [this, t, &b, turn, max_depth]() { iterate(mWorkers[t], b, turn, max_depth); } ) );
+
+        iterate(mWorkers[0], b, turn, max_depth);
+        mStop = true;
+        for (size_t t=0;t!=helpers.size();++t)
+            helpers[t].join();
+
+        mTimeOut = 0;
+        mDepth = mWorkers[0].mDepth;
+        mScore = mWorkers[0].mScore;
+        return mWorkers[0].mBest;
+    }
+}
@@ -0,0 +1,159 @@
+// alphabeta.h
+//
+// Iterative deepening alpha-beta search, the alternative to mcts:
+// a principal variation search over negamax, deepening a ply at a time,
+// each iteration searched within an aspiration window about the last one's score,
+// with a transposition table, and moves ordered by the table's move,
+// then the killer moves of the ply, then the history heuristic,
+// by placement position and rotation, scoring leaves with the static evaluation.
+//
+// With more than one thread it's a lazy SMP search: every thread deepens on the same root,
+// sharing only the transposition table, which is lockless (see lockless_table).
+// The helper threads vary their move order, and half of them their depths,
+// so they fill the table ahead of the main thread rather than repeating it.
+// The main thread alone calls the timeOut, and its move is the one played.
+//
+// Its GetMove has the shape of mcts::Node::GetMove, the timeOut being called once a node:
+//
+// pentago::move ai_move = alphabeta_search::GetMove( gameState, timeOutFn );
+
+#ifndef ALPHABETA_H_INCLUDED
+#define ALPHABETA_H_INCLUDED
+
+#include "pentago.h"
+#include "evaluate.h"
+#include "mcts.h"
+#include "locklesstable.h"
+
+#include <cstdint>
+#include <vector>
+#include <functional>
+#include <atomic>
+
+namespace pentago
+{
+    // for the side to move, a win scores above any evaluation, less the plies to it,
+    // so the sooner wins, and the later losses, are preferred
+    const int win_score = 30000;
+
+    class alphabeta_search
+    {
+        public:
+            typedef std::function< bool() > timeout_fn;
+
+            // the transposition table holds as many positions as fit in bytes,
+            // threads search together, 0 for one per hardware thread
+            static const size_t default_table_bytes = 4 << 20;
+            explicit alphabeta_search( size_t bytes=default_table_bytes, int threads=1 );
+
+            // searches b for the side to move, deepening until timeOut returns false,
+            // or max_depth plies, or a win or loss is found,
+            // returns the best move of the deepest iteration completed
+            move search( const board& b, int turn, const timeout_fn& timeOut, int max_depth=6*6 );
+
+            // of the deepest iteration completed by the last search
+            int depth() const
+            {
+                return mDepth;
+            }
+
+            int score() const
+            {
+                return mScore;
+            }
+
+            // searched by every thread in the last search
+            uint64_t nodes() const;
+
+            int threads() const
+            {
+                return (int)mWorkers.size();
+            }
+
+            // forgets every position, and the move ordering statistics
+            void clear();
+
+            // for mcts adaptors with mBoard and mTurn (see GameState)
+            template< typename GameState, typename TimeoutFn >
+            static move GetMove( const GameState& game, TimeoutFn timeOut, int threads=1 )
+            {
+                alphabeta_search search( default_table_bytes, threads );
+                return search.search( game.mBoard, game.mTurn, [&timeOut]() { return timeOut(); } );
+            }
+
+        private:
+            // not copyable
+            alphabeta_search( const alphabeta_search& );
+            alphabeta_search& operator=( const alphabeta_search& );
+
+            enum bound
+            {
+                unused,
+                exact,
+                lower,
+                upper
+            };
+
+            // an entry's data, packed into a word
+            struct entry
+            {
+                int mScore;
+                int mDepth;
+                bound mBound;
+                uint16_t mMove;
+                uint16_t mGeneration;
+
+                uint64_t pack() const;
+                static entry unpack( uint64_t data );
+            };
+
+            // everything a thread searches with but the table
+            struct worker
+            {
+                int mId;
+
+                // by ply, the last two moves to cause a cutoff
+                move mKillers[6*6][2];
+                bool mHasKiller[6*6][2];
+
+                // by placement position and rotation, weighted by depth squared for each cutoff
+                int mHistory[6*6][8];
+
+                // the helpers' move order jitter
+                mcts::Random mRandom;
+
+                uint64_t mNodes;
+
+                // of the iteration being searched, and the last completed
+                move mRootBest;
+                move mBest;
+                int mDepth;
+                int mScore;
+            };
+
+            // deepens on b until stopped, for any thread
+            void iterate( worker& w, const board& b, int turn, int max_depth );
+
+            int negamax( worker& w, const board& b, const line_counts& counts, int turn, int depth, int ply,
+                int alpha, int beta );
+
+            // ordering scores for the moves of a node, best first
+            void order( worker& w, const move* moves, int n, int ply, const entry* e, int* scores ) const;
+
+            bool probe( uint64_t key, entry* e ) const;
+            void store( uint64_t key, const entry& e );
+
+            // entries packed into the table's values
+            lockless_table mTable;
+            uint16_t mGeneration;
+
+            std::vector< worker > mWorkers;
+            const timeout_fn* mTimeOut;
+            std::atomic< bool > mStop;
+
+            int mDepth;
+            int mScore;
+    };
+}
+
+#endif
@@ -0,0 +1,126 @@
+// book.cpp
+
+#include "book.h"
+
+#include <cstdio>
+
+#include <algorithm>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+namespace pentago
+{
+    bool opening_book::load( const char* path )
+    {
+        return mDatabase.open(path);
+    }
+    
+    bool opening_book::save( const char* path ) const
+    {
+        position_database_builder builder;
+        for (uint64_t i=0;i!=mDatabase.size();++i)
+            builder.add( mDatabase.records()[i] );
+        for (size_t i=0;i!=mAdded.size();++i)
+            builder.add( mAdded[i] );
+        
+        return builder.write(path);
+    }
+    
+    void opening_book::add( const board& b, const move& m, uint32_t visits )
+    {
+        UInt symmetry;
+        position_record r;
+        r.mKey = canonical(b, &symmetry);
+        r.mVisits = visits;
+        r.mValue = 0;
+        r.mMove = transform(m, symmetry).pack();
+        
+        std::vector< position_record >::iterator i = std::lower_bound(mAdded.begin(), mAdded.end(), r);
+        if (i!=mAdded.end() && i->mKey==r.mKey)
+            *i = r;
+        else
+            mAdded.insert(i, r);
+    }
+    
+    bool opening_book::lookup( const board& b, move* m ) const
+    {
+        UInt symmetry;
+        position_record r;
+        r.mKey = canonical(b, &symmetry);
+        
+        const position_record* found = 0;
+        std::vector< position_record >::const_iterator i = std::lower_bound(mAdded.begin(), mAdded.end(), r);
+        if (i!=mAdded.end() && i->mKey==r.mKey)
+            found = &*i;
+        else
+            found = mDatabase.find(r.mKey);
+        
+        if (found==0 || found->mMove==position_record::no_move)
+            return false;
+        
+        // back from the canonical board to the one asked about
+        *m = transform( move::unpack(found->mMove), inverse_symmetry(symmetry) );
+        return true;
+    }
+    
+    void build_book( const book_settings& settings, opening_book* book )
+    {
+        int threads = settings.mThreads;
+        if (threads<=0) threads = std::max( 1u, std::thread::hardware_concurrency() );
+        
+        std::vector< board > level(1);
+        for (int ply=0; ply!=settings.mPlies; ++ply)
+        {
+            if (settings.mProgress)
+                fprintf(stderr, "ply %i, %i positions\n", ply, (int)level.size());
+            
+            // search this ply's positions in parallel
+            std::mutex lock;
+            std::atomic<int> next(0);
+            std::vector< std::thread > workers;
+            for (int t=0;t!=threads;++t)
+            {
+                workers.push_back( std::thread( [&]() {
+                    for (int i=next++; i<(int)level.size(); i=next++)
+                    {
+                        GameState game(level[i], ply);
+                        game.mRollout = settings.mRollout;
+                        game.mCutoff = settings.mCutoff;
+                        
+                        pentago::move m = mcts::Node< pentago::move >::GetMove( 
+                            game, IterationTimeOut(settings.mPlayouts), settings.mConfig );
+                        
+                        std::lock_guard< std::mutex > guard(lock);
+                        book->add(level[i], m, settings.mPlayouts);
+                    }
+                } ) );
+            }
+            for (size_t t=0;t!=workers.size();++t)
+                workers[t].join();
+            
+            if (ply+1==settings.mPlies) break;
+            
+            // the canonical positions of the next ply
+            std::set< uint64_t > seen;
+            std::vector< board > following;
+            std::vector< pentago::move > moves;
+            for (size_t i=0;i!=level.size();++i)
+            {
+                all_moves(level[i], ply, &moves);
+                for (size_t m=0;m!=moves.size();++m)
+                {
+                    board b = level[i];
+                    moves[m].apply(&b, ply);
+                    if (b.winning()!=empty) continue;
+                    
+                    UInt symmetry;
+                    if (seen.insert( canonical(b, &symmetry) ).second)
+                        following.push_back( transform(b, symmetry) );
+                }
+            }
+            level.swap(following);
+        }
+    }
+}
@@ -0,0 +1,73 @@
+// book.h
+//
+// Opening book, the moves chosen by long offline searches of the early positions.
+// Entries are keyed by canonical board, so each covers all the symmetries of its position.
+
+#ifndef BOOK_H_INCLUDED
+#define BOOK_H_INCLUDED
+
+#include "pentago.h"
+#include "gamestate.h"
+#include "mcts.h"
+#include "posdb.h"
+
+#include <vector>
+
+namespace pentago
+{
+    // stored as a position_database, with the move chosen for each position
+    class opening_book
+    {
+        public:
+            // memory maps the file
+            bool load( const char* path );
+            bool save( const char* path ) const;
+            
+            // for the position b, in any orientation
+            void add( const board& b, const move& m, uint32_t visits=0 );
+            bool lookup( const board& b, move* m ) const;
+            
+            size_t size() const
+            {
+                return mDatabase.size() + mAdded.size();
+            }
+            
+        private:
+            // loaded from file, and added since, sorted by key
+            position_database mDatabase;
+            std::vector< position_record > mAdded;
+    };
+    
+    struct book_settings
+    {
+        book_settings()
+            : mPlies(2)
+            , mPlayouts(100000)
+            , mThreads(0)
+            , mRollout(uniform_rollout)
+            , mCutoff(0)
+            , mProgress(true)
+        { }
+        
+        // positions with fewer than this many stones are searched
+        int mPlies;
+        
+        // mcts iterations per position
+        int mPlayouts;
+        
+        // 0 for one per hardware thread
+        int mThreads;
+        
+        rollout_policy mRollout;
+        int mCutoff;
+        mcts::Config mConfig;
+        
+        // report each ply to stderr
+        bool mProgress;
+    };
+    
+    // searches every canonical position of the first mPlies plies, progress to stderr
+    void build_book( const book_settings& settings, opening_book* book );
+}
+
+#endif
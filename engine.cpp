@@ -0,0 +1,298 @@
+// engine.cpp
+
+#include "engine.h"
+#include "gamestate.h"
+#include "splitstate.h"
+#include "proof.h"
+#include "alphabeta.h"
+
+#include <cstdio>
+
+#include <sstream>
+#include <algorithm>
+
+namespace pentago
+{
+    bool parse_position( std::istream& args, board* b, int* turn, std::string* error )
+    {
+        *b = board();
+        *turn = 0;
+
+        std::string token;
+        args >> token;
+        if (token=="board")
+        {
+            std::string rows;
+            if (!(args >> rows) || rows.length() < 6*7-1)
+            {
+                *error = "expected a board of 6 rows of 6";
+                return false;
+            }
+            *b = board::fromstring(rows.c_str());
+            int stones[2] = { 0, 0 };
+            for (UInt i=0;i!=6*6;++i)
+            {
+                const state s = b->get(position(i));
+                if (s==white) ++stones[0];
+                else if (s==black) ++stones[1];
+                else if (s==invalid)
+                {
+                    *error = "expected . O or X";
+                    return false;
+                }
+            }
+
+            // white moves first, so has as many stones as black, or one more
+            if (stones[0]!=stones[1] && stones[0]!=stones[1]+1)
+            {
+                *error = "expected as many O stones as X, or one more";
+                return false;
+            }
+            *turn = stones[0] + stones[1];
+        }
+        else if (token!="start")
+        {
+            *error = "expected start or board";
+            return false;
+        }
+
+        if (args >> token)
+        {
+            if (token!="moves")
+            {
+                *error = "expected moves, not " + token;
+                return false;
+            }
+            while (args >> token)
+            {
+                if (valid_move(token)==false)
+                {
+                    *error = "invalid move: " + token;
+                    return false;
+                }
+                const pentago::move m = move::fromstring(token.c_str());
+                if (b->get(m.mP)!=empty || *turn==6*6 || b->winning()!=empty)
+                {
+                    *error = "illegal move: " + token;
+                    return false;
+                }
+                m.apply(b, (*turn)++);
+            }
+        }
+        return true;
+    }
+
+    pentago::move choose_move( const engine_settings& engine, const opening_book* book, const tablebase* tb,
+        const board& b, int turn, mcts::Arena< pentago::move >& arena, search_limit limit, const char** source,
+        mcts::Stats< pentago::move >* stats )
+    {
+        pentago::move m;
+        tablebase_result result;
+        if (book && book->lookup(b, &m))
+        {
+            *source = "book";
+            return m;
+        }
+        if (tb && 6*6-turn<=tablebase_max_empties && tb->best_move(b, turn, &m, &result))
+        {
+            *source = "tablebase";
+            return m;
+        }
+
+        if (engine.mKind==alphabeta_engine)
+        {
+            *source = "search";
+            return alphabeta_search::GetMove( GameState(b, turn), limit, engine.mThreads );
+        }
+        if (engine.mKind!=mcts_engine)
+        {
+            *source = "search";
+            mcts::Random rng( turn+1 );
+            ++*limit.mIterations;
+            return engine_move(engine, b, turn, rng);
+        }
+        if (engine.mProof>0 && proven_win(b, turn, engine.mProof, &m))
+        {
+            *source = "proof";
+            return m;
+        }
+
+        *source = "search";
+
+        GameState game(b, turn);
+        game.mRollout = engine.mRollout;
+        game.mCutoff = engine.mCutoff;
+        game.mTablebase = tb;
+        if (engine.mSplit)
+            return split_move( game, limit, engine.mConfig, arena, stats );
+        return mcts::Node< pentago::move >::GetMove( game, limit, engine.mConfig, arena, stats );
+    }
+
+    static std::string move_string( const pentago::move& m )
+    {
+        return tostring(m);
+    }
+
+    std::string stats_json( const mcts::Stats< pentago::move >& stats )
+    {
+        return stats.Json( move_string );
+    }
+
+    engine_server::engine_server( const engine_settings& engine )
+        : mBook(0)
+        , mTablebase(0)
+        , mEngine(engine)
+        , mArena(engine.mConfig.mNodeBudget)
+        , mTurn(0)
+        , mStop(false)
+        , mOut(0)
+    { }
+
+    engine_server::~engine_server()
+    {
+        mStop = true;
+        wait();
+    }
+
+    void engine_server::send( const std::string& line )
+    {
+        std::lock_guard< std::mutex > guard(mLock);
+        *mOut << line << std::endl;
+    }
+
+    void engine_server::wait()
+    {
+        if (mSearch.joinable()) mSearch.join();
+    }
+
+    void engine_server::run( std::istream& in, std::ostream& out )
+    {
+        mOut = &out;
+
+        std::string line;
+        while (std::getline(in, line))
+        {
+            std::istringstream args(line);
+            std::string command;
+            if (!(args >> command)) continue;
+
+            if (command=="stop")
+                mStop = true;
+            else if (command=="isready")
+                send("readyok");
+            else if (command=="info")
+            {
+                std::lock_guard< std::mutex > guard(mLock);
+                *mOut << (mInfo.empty() ? "info none" : mInfo) << std::endl;
+            }
+            else if (command=="stats")
+            {
+                std::lock_guard< std::mutex > guard(mLock);
+                *mOut << "stats " << stats_json(mStats) << std::endl;
+            }
+            else if (command=="quit")
+            {
+                mStop = true;
+                break;
+            }
+            else
+            {
+                wait();
+                if (command=="position")
+                    set_position(args);
+                else if (command=="go")
+                    start_search(args);
+                else
+                    send("error unknown command: " + command);
+            }
+        }
+
+        // at the end of the input, the last search is still answered
+        wait();
+        mOut = 0;
+    }
+
+    void engine_server::set_position( std::istream& args )
+    {
+        board b;
+        int turn;
+        std::string error;
+        if (parse_position(args, &b, &turn, &error)==false)
+        {
+            send("error " + error);
+            return;
+        }
+
+        mBoard = b;
+        mTurn = turn;
+    }
+
+    void engine_server::start_search( std::istream& args )
+    {
+        int playouts = 0;
+        int milliseconds = 0;
+        int clock = 0;
+        int increment = 0;
+
+        std::string token;
+        while (args >> token)
+        {
+            int n;
+            if (!(args >> n) || n<0 ||
+                (token!="playouts" && token!="movetime" && token!="clock" && token!="increment"))
+            {
+                send("error expected playouts N, movetime MS, clock MS or increment MS");
+                return;
+            }
+            (token=="playouts" ? playouts : token=="movetime" ? milliseconds : token=="clock" ? clock : increment) = n;
+        }
+
+        if (mBoard.winning()!=empty || mTurn==6*6)
+        {
+            send("error game over");
+            return;
+        }
+
+        // a share of the game clock, aiming for the target, and going on to the maximum if the move is unsettled,
+        // with as many moves left as the side could still have to play
+        double target = 0;
+        if (clock>0 && milliseconds==0)
+        {
+            double maximum;
+            mcts::GameClock( clock/1000.0, increment/1000.0 ).Budget( (6*6-mTurn+1)/2, &target, &maximum );
+            milliseconds = std::max( 1, (int)(maximum*1000) );
+        }
+
+        // the engine's own budget, unless the request sets one
+        if (playouts==0 && milliseconds==0)
+            playouts = mEngine.mPlayouts;
+
+        mStop = false;
+        mSearch = std::thread( &engine_server::search, this, playouts, milliseconds, target );
+    }
+
+    void engine_server::search( int playouts, int milliseconds, double target )
+    {
+        const engine_clock::time_point start = engine_clock::now();
+
+        const char* source;
+        int iterations = 0;
+        search_limit limit( playouts, milliseconds>0, start + std::chrono::milliseconds(milliseconds),
+            &mStop, &iterations, target );
+        mcts::Stats< pentago::move > stats;
+        const pentago::move m = choose_move(mEngine, mBook, mTablebase, mBoard, mTurn, mArena, limit, &source, &stats);
+
+        const double ms = std::chrono::duration< double, std::milli >( engine_clock::now() - start ).count();
+
+        char info[128];
+        snprintf(info, sizeof(info), "info source %s iterations %i time %.0f nps %.0f",
+            source, iterations, ms, ms>0 ? iterations*1000.0/ms : 0.0);
+        {
+            std::lock_guard< std::mutex > guard(mLock);
+            mInfo = info;
+            mStats = stats;
+        }
+        send(info);
+        send("bestmove " + tostring(m));
+    }
+}
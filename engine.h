@@ -0,0 +1,150 @@
+// engine.h
+//
+// Line based engine protocol over a pair of streams (stdin and stdout with "pentago engine"),
+// so a long running process can answer many move requests,
+// keeping its node arena, book and tablebase loaded between them.
+//
+// Requests, one per line:
+//    position start [moves A1B+ ...]
+//    position board <6 rows of 6, each followed by any separator> [moves ...]
+//        the side to move is worked out from the number of stones
+//    go [playouts N] [movetime MS] [clock MS [increment MS]]
+//        searches the position, in the background, answering with
+//        "info ..." for the search and then "bestmove A1B+",
+//        a timed search stops early once its move can't change,
+//        and with the time left on the side's game clock, instead of a movetime,
+//        takes a share of it, more when the move is unsettled
+//    stop      - ends the search early, it still answers with its move
+//    info      - repeats the info line of the last search
+//    stats     - answers "stats {...}", the last search's mcts::Stats as JSON
+//    isready   - answers "readyok"
+//    quit      - stops any search and returns,
+//                at the end of the input any search is finished first
+//
+// Requests other than stop, info and isready wait for a running search to finish,
+// so requests may be streamed without waiting for each answer.
+// Malformed requests are answered with "error <reason>".
+
+#ifndef ENGINE_H_INCLUDED
+#define ENGINE_H_INCLUDED
+
+#include "pentago.h"
+#include "mcts.h"
+#include "tournament.h"
+#include "book.h"
+#include "tablebase.h"
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+namespace pentago
+{
+    typedef std::chrono::steady_clock engine_clock;
+
+    // mcts timeout, ending the search on stop, after mPlayouts iterations (when non-zero),
+    // or at the deadline (when timed),
+    // a timed search of a tree (see mcts::TimeManager) aims for target seconds (0 for the deadline),
+    // stopping sooner when the move is settled, and only going on to the deadline when it isn't
+    struct search_limit
+    {
+        search_limit( int playouts, bool timed, engine_clock::time_point deadline,
+            const std::atomic< bool >* stop, int* iterations, double target=0 )
+            : mPlayouts(playouts)
+            , mDeadline(deadline)
+            , mTimed(timed)
+            , mStop(stop)
+            , mIterations(iterations)
+            , mManager( target>0 ? target : seconds_until(deadline), seconds_until(deadline) )
+        { }
+
+        static double seconds_until( engine_clock::time_point t )
+        {
+            return std::chrono::duration< double >( t - engine_clock::now() ).count();
+        }
+
+        bool operator()()
+        {
+            ++*mIterations;
+            if (mStop && *mStop) return false;
+            if (mPlayouts && *mIterations>=mPlayouts) return false;
+            return mTimed==false || engine_clock::now() < mDeadline;
+        }
+
+        template< typename TreeType >
+        bool operator()( const TreeType& tree )
+        {
+            return (*this)() && (mTimed==false || mManager(tree));
+        }
+
+        int mPlayouts;
+        engine_clock::time_point mDeadline;
+        bool mTimed;
+        const std::atomic< bool >* mStop;
+        int* mIterations;
+        mcts::TimeManager mManager;
+    };
+
+    // reads "start" or "board <rows>", then optionally "moves ...", to the end of args,
+    // the side to move of a board is worked out from the number of stones,
+    // and a board with any other character, or the wrong number of either player's stones, is rejected
+    bool parse_position( std::istream& args, board* b, int* turn, std::string* error );
+
+    // the book or tablebase move (either may be 0) when there is one,
+    // then a proven win when the engine looks for one (see engine_settings::mProof), otherwise a search,
+    // source is set to which answered, and an mcts search fills stats when given
+    pentago::move choose_move( const engine_settings& engine, const opening_book* book, const tablebase* tb,
+        const board& b, int turn, mcts::Arena< pentago::move >& arena, search_limit limit, const char** source,
+        mcts::Stats< pentago::move >* stats=0 );
+
+    // see mcts::Stats::Json
+    std::string stats_json( const mcts::Stats< pentago::move >& stats );
+
+    class engine_server
+    {
+        public:
+            // the search used by go, when not limited by the request,
+            // searches run for mPlayouts iterations (alpha-beta nodes)
+            engine_server( const engine_settings& engine );
+            ~engine_server();
+
+            // consulted before searching, when set
+            const opening_book* mBook;
+            const tablebase* mTablebase;
+
+            // answers requests from in until quit or the end of the input
+            void run( std::istream& in, std::ostream& out );
+
+        private:
+            // not copyable
+            engine_server( const engine_server& );
+            engine_server& operator=( const engine_server& );
+
+            void set_position( std::istream& args );
+            void start_search( std::istream& args );
+            void search( int playouts, int milliseconds, double target );
+            void wait();
+
+            // a line of output, whole, whichever thread is writing
+            void send( const std::string& line );
+
+            engine_settings mEngine;
+            mcts::Arena< pentago::move > mArena;
+
+            board mBoard;
+            int mTurn;
+
+            std::thread mSearch;
+            std::atomic< bool > mStop;
+
+            std::string mInfo;
+            mcts::Stats< pentago::move > mStats;
+            std::ostream* mOut;
+            std::mutex mLock;
+    };
+}
+
+#endif
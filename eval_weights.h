@@ -0,0 +1,11 @@
+// eval_weights.h
+//
+// Feature weights for evaluate.cpp, in 1/100ths of a logit of white's winning chances.
+// Generated by "pentago tune games=1000 playouts=1000" from 14820 positions.
+
+0, // open_2
+14, // open_3
+69, // open_4
+0, // blocked_2
+15, // blocked_3
+8, // blocked_4
@@ -0,0 +1,109 @@
+// evaluate.cpp
+
+#include "evaluate.h"
+
+namespace pentago
+{
+    // regenerate with "pentago tune > eval_weights.h"
+    const int feature_weights[feature_count] = {
+        #include "eval_weights.h"
+    };
+
+    line_counts::line_counts()
+    {
+        memset(mCount,0,sizeof(mCount));
+        memset(mFeatures,0,sizeof(mFeatures));
+    }
+
+    line_counts::line_counts( const board& b )
+    {
+        memset(mFeatures,0,sizeof(mFeatures));
+        for (UInt l=0;l!=line_count;++l)
+        {
+            count_line(b, l);
+            add_line(l, 1);
+        }
+    }
+
+    void line_counts::count_line( const board& b, UInt l )
+    {
+        mCount[0][l] = 0;
+        mCount[1][l] = 0;
+        for (UInt n=0;n!=line_length;++n)
+        {
+            const state s = b.get(position(lines[l][n]));
+            if (s!=empty) mCount[s-1][l]++;
+        }
+    }
+
+    void line_counts::add_line( UInt l, int sign )
+    {
+        for (UInt c=0;c!=2;++c)
+        {
+            // complete lines end the game, they aren't features
+            const UInt n = mCount[c][l];
+            if (n<2 || n>4) continue;
+
+            const UInt f = (mCount[c^1][l]==0) ? open_2 : blocked_2;
+            mFeatures[c][f+n-2] += sign;
+        }
+    }
+
+    bool line_counts::place( position p, state s )
+    {
+        bool result = false;
+        const UInt i = p.get();
+        for (UInt n=0;n!=position_line_count[i];++n)
+        {
+            const UInt l = position_lines[i][n];
+            add_line(l, -1);
+            if (++mCount[s-1][l]==line_length) result = true;
+            add_line(l, 1);
+        }
+        return result;
+    }
+
+    void line_counts::remove( position p, state s )
+    {
+        const UInt i = p.get();
+        for (UInt n=0;n!=position_line_count[i];++n)
+        {
+            const UInt l = position_lines[i][n];
+            add_line(l, -1);
+            mCount[s-1][l]--;
+            add_line(l, 1);
+        }
+    }
+
+    void line_counts::rotate( const board& b, rotation::quadrant q )
+    {
+        for (UInt n=0;n!=lines_per_quadrant;++n)
+        {
+            const UInt l = quadrant_lines[q][n];
+            add_line(l, -1);
+            count_line(b, l);
+            add_line(l, 1);
+        }
+    }
+
+    void line_counts::apply( const move& m, state s, const board& after )
+    {
+        // move::apply skips the rotation when the placement wins
+        if (place(m.mP, s)==false)
+            rotate(after, m.mR.get_quadrant());
+    }
+
+    int line_counts::evaluate( state s ) const
+    {
+        const UInt us = s-1;
+        int result = 0;
+        for (UInt f=0;f!=feature_count;++f)
+            result += feature_weights[f] * (mFeatures[us][f] - mFeatures[us^1][f]);
+        return result;
+    }
+
+    int evaluate( const board& b, state s )
+    {
+        return line_counts(b).evaluate(s);
+    }
+}
@@ -0,0 +1,76 @@
+// evaluate.h
+//
+// Static evaluation of a board, from counts of stones along the 32 winning lines.
+// Usable as a rollout cutoff, MCTS prior, or alpha-beta leaf score.
+
+#ifndef EVALUATE_H_INCLUDED
+#define EVALUATE_H_INCLUDED
+
+#include "pentago.h"
+
+namespace pentago
+{
+    // line patterns counted for each colour:
+    // open lines hold only that colour's stones,
+    // blocked lines hold stones of both colours
+    enum feature
+    {
+        open_2,
+        open_3,
+        open_4,
+        blocked_2,
+        blocked_3,
+        blocked_4,
+        feature_count
+    };
+
+    // weights applied to the difference between the players feature counts
+    extern const int feature_weights[feature_count];
+
+    // per line stone counts, and the feature totals they give,
+    // maintained incrementally as stones are placed and quadrants rotated
+    class line_counts
+    {
+        public:
+            line_counts();
+            explicit line_counts( const board& b );
+
+            // a stone of colour s has been placed at p,
+            // returns true if it completes a line of 5
+            bool place( position p, state s );
+
+            // the stone of colour s at p has been removed
+            void remove( position p, state s );
+
+            // quadrant q of b has been rotated, recount the lines crossing it
+            void rotate( const board& b, rotation::quadrant q );
+
+            // as move::apply, for colour s, where after is the resulting board
+            void apply( const move& m, state s, const board& after );
+
+            UInt count( UInt line, state s ) const
+            {
+                return mCount[s-1][line];
+            }
+
+            int features( state s, feature f ) const
+            {
+                return mFeatures[s-1][f];
+            }
+
+            // positive scores favour colour s
+            int evaluate( state s ) const;
+
+        private:
+            void add_line( UInt line, int sign );
+            void count_line( const board& b, UInt line );
+
+            uint8_t mCount[2][line_count];
+            int16_t mFeatures[2][feature_count];
+    };
+
+    // positive scores favour colour s
+    int evaluate( const board& b, state s );
+}
+
+#endif
@@ -0,0 +1,102 @@
+// gamerecord.cpp
+
+#include "gamerecord.h"
+
+#include <cstring>
+
+namespace pentago
+{
+    static const char game_record_magic[4] = { 'P', 'G', 'R', '1' };
+
+    // a game never has more moves than the board has spaces
+    static const UInt max_game_moves = 6*6;
+
+    board game_record::final_board() const
+    {
+        board b;
+        for (size_t i=0;i!=mMoves.size();++i)
+            mMoves[i].apply( &b, (int)i );
+        return b;
+    }
+
+    bool game_writer::open( const char* path )
+    {
+        close();
+        mFile = fopen(path, "ab");
+        if (!mFile) return false;
+
+        // append mode always writes at the end, which is the start for a new file
+        fseek(mFile, 0, SEEK_END);
+        if (ftell(mFile)==0 && fwrite(game_record_magic, 4, 1, mFile)!=1)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void game_writer::close()
+    {
+        if (mFile) fclose(mFile);
+        mFile = 0;
+    }
+
+    bool game_writer::append( const game_record& g )
+    {
+        if (!mFile || g.mMoves.size() > max_game_moves) return false;
+
+        uint16_t buffer[1+max_game_moves];
+        const size_t n = g.mMoves.size();
+        buffer[0] = (uint16_t)(n | ((g.mWinner+1) << 8));
+        for (size_t i=0;i!=n;++i)
+            buffer[1+i] = g.mMoves[i].pack();
+
+        std::lock_guard< std::mutex > guard(mLock);
+        return fwrite(buffer, sizeof(uint16_t), 1+n, mFile)==1+n;
+    }
+
+    void game_writer::flush()
+    {
+        std::lock_guard< std::mutex > guard(mLock);
+        if (mFile) fflush(mFile);
+    }
+
+    bool game_reader::open( const char* path )
+    {
+        close();
+        mFile = fopen(path, "rb");
+        if (!mFile) return false;
+
+        char magic[4];
+        if (fread(magic, 4, 1, mFile)!=1 || memcmp(magic, game_record_magic, 4)!=0)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void game_reader::close()
+    {
+        if (mFile) fclose(mFile);
+        mFile = 0;
+    }
+
+    bool game_reader::next( game_record* g )
+    {
+        uint16_t header;
+        if (!mFile || fread(&header, sizeof(header), 1, mFile)!=1) return false;
+
+        const size_t n = header & 0xff;
+        if (n > max_game_moves) return false;
+
+        uint16_t buffer[max_game_moves];
+        if (fread(buffer, sizeof(uint16_t), n, mFile)!=n) return false;
+
+        g->mWinner = (int)(header >> 8) - 1;
+        g->mMoves.resize(n);
+        for (size_t i=0;i!=n;++i)
+            g->mMoves[i] = move::unpack(buffer[i]);
+        return true;
+    }
+}
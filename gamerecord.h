@@ -0,0 +1,97 @@
+// gamerecord.h
+//
+// Compact binary game records, for logging every game played
+// and streaming them back for offline analysis.
+//
+// File format, native (little) endian:
+//    4 byte magic "PGR1",
+//    then for each game, a uint16 header: move count in the low 8 bits,
+//    winner+1 above (see GameState::GetWinner, 0 for none),
+//    followed by one uint16 per move (see move::pack).
+
+#ifndef GAMERECORD_H_INCLUDED
+#define GAMERECORD_H_INCLUDED
+
+#include "pentago.h"
+
+#include <cstdio>
+
+#include <vector>
+#include <mutex>
+
+namespace pentago
+{
+    struct game_record
+    {
+        game_record() : mWinner(-1) { }
+
+        std::vector< move > mMoves;
+
+        // 0 white, 1 black, 2 both, -1 neither (a draw, or unfinished)
+        int mWinner;
+
+        // the position after all the moves
+        board final_board() const;
+    };
+
+    // appends games to a file, safe to share between threads
+    class game_writer
+    {
+        public:
+            game_writer() : mFile(0) { }
+            ~game_writer()
+            {
+                close();
+            }
+
+            // writes the magic if the file is new
+            bool open( const char* path );
+            void close();
+
+            bool is_open() const
+            {
+                return mFile!=0;
+            }
+
+            // one buffered write per game
+            bool append( const game_record& g );
+
+            // pushes buffered games to the file
+            void flush();
+
+        private:
+            // owns the file, not copyable
+            game_writer( const game_writer& );
+            game_writer& operator=( const game_writer& );
+
+            FILE* mFile;
+            std::mutex mLock;
+    };
+
+    // reads games one at a time, so files of any size can be scanned
+    class game_reader
+    {
+        public:
+            game_reader() : mFile(0) { }
+            ~game_reader()
+            {
+                close();
+            }
+
+            // false if the file is missing, or isn't a game record file
+            bool open( const char* path );
+            void close();
+
+            // false at the end of the file, or on a truncated game
+            bool next( game_record* g );
+
+        private:
+            // owns the file, not copyable
+            game_reader( const game_reader& );
+            game_reader& operator=( const game_reader& );
+
+            FILE* mFile;
+    };
+}
+
+#endif
@@ -0,0 +1,335 @@
+// gamestate.h
+//
+// mcts adaptor for the board_18 class,
+// with the move generator and playout policies it's built on
+
+#ifndef GAMESTATE_H_INCLUDED
+#define GAMESTATE_H_INCLUDED
+
+#include "pentago.h"
+#include "evaluate.h"
+#include "tablebase.h"
+
+#include <vector>
+#include <iterator>
+
+namespace pentago
+{
+    enum rollout_policy
+    {
+        uniform_rollout,
+        heuristic_rollout
+    };
+
+    // the most moves of any position, every empty position with every rotation,
+    // enough for an array all_moves writes to
+    const int max_moves = 6*6*8;
+
+    template< typename ItrOut >
+    ItrOut all_moves(const board& b, int turn, ItrOut moves)
+    {
+        // simple test for empty positions generator
+        empty_positions itr(b);
+    
+        while (itr.finished()==false)
+        {
+            position p = itr.get();
+            rotation r;
+            while (r.valid())
+            {
+                // filter out anti-clockwise rotations of symmetrical quadrants
+                if (r.get_direction()==rotation::clockwise ||
+                    r.symetrical(&b)==false)
+                {
+                    *moves++ = pentago::move( p, r );
+                }
+                r.next();
+            }
+            itr.next();
+        }
+    
+        return moves;
+    }
+
+    inline void all_moves(const board& b, int turn, std::vector< pentago::move >* moves)
+    {
+        moves->reserve( (6*6*4*2)-turn );
+        moves->resize( 0 );
+        all_moves(b, turn, std::back_inserter( *moves ));
+    }
+
+    inline rotation random_rotation(int r)
+    {
+        return rotation( (rotation::quadrant)(r&3), (rotation::direction)(r&4) );
+    }
+
+    // light playout policy, any empty position, any rotation
+    template< typename Rng >
+    pentago::move uniform_move(const board& b, int turn, Rng& rng)
+    {
+        int n = rng( (6*6)-turn );
+        empty_positions itr(b);
+        while (n--) itr.next();
+    
+        return pentago::move( itr.get(), random_rotation( rng(8) ) );
+    }
+
+    // the weight of each position for the heavy playout policy, and the mcts priors,
+    // 0 for occupied positions, otherwise 1 plus the weight of the open lines through it,
+    // win and block are given the positions completing our own, or the opponent's, four (or -1)
+    inline void placement_weights(const board& b, const line_counts& counts, int turn, int weight[6*6], int* win, int* block)
+    {
+        // by count of stones already in an open line
+        static const int line_weight[line_length] = { 1, 2, 4, 16, 0 };
+    
+        const state us = turntostate(turn);
+        const state them = turntostate(turn+1);
+    
+        for (UInt i=0;i!=6*6;++i)
+            weight[i] = (b.get(position(i))==empty) ? 1 : 0;
+    
+        *win = -1;
+        *block = -1;
+        for (UInt l=0;l!=line_count;++l)
+        {
+            const UInt ours = counts.count(l, us);
+            const UInt theirs = counts.count(l, them);
+        
+            // lines held by both players can't be won, so carry no weight
+            int w;
+            if (theirs==0) w = line_weight[ours];
+            else if (ours==0) w = line_weight[theirs];
+            else continue;
+        
+            for (UInt n=0;n!=line_length;++n)
+            {
+                const UInt i = lines[l][n];
+                if (weight[i]==0) continue;
+            
+                weight[i] += w;
+                if (ours==4) *win = i;
+                else if (theirs==4) *block = i;
+            }
+        }
+    }
+    
+    // heavy playout policy:
+    // complete our own four when we can (an immediate win),
+    // otherwise block the opponent's four,
+    // otherwise choose a position at random, weighted by the open lines through it
+    template< typename Rng >
+    pentago::move heuristic_move(const board& b, const line_counts& counts, int turn, Rng& rng)
+    {
+        int weight[6*6], win, block;
+        placement_weights(b, counts, turn, weight, &win, &block);
+    
+        int chosen = (win>=0) ? win : block;
+        if (chosen<0)
+        {
+            int total = 0;
+            for (UInt i=0;i!=6*6;++i)
+                total += weight[i];
+        
+            int pick = rng(total);
+            for (chosen=0; pick>=weight[chosen]; ++chosen)
+                pick -= weight[chosen];
+        }
+    
+        return pentago::move( position(chosen), random_rotation( rng(8) ) );
+    }
+
+    template< typename Rng >
+    pentago::move heuristic_move(const board& b, int turn, Rng& rng)
+    {
+        return heuristic_move(b, line_counts(b), turn, rng);
+    }
+
+    // flat monte carlo, the move with the best score over
+    // playouts uniform random playouts of each possible move
+    template< typename Rng >
+    pentago::move flat_move(const board& b, int turn, int playouts, Rng& rng)
+    {
+        std::vector< pentago::move > moves;
+        all_moves(b, turn, &moves);
+    
+        std::vector< int > score( moves.size() );
+        for (int s=0;s!=playouts;++s)
+        {
+            for (size_t m=0;m!=moves.size();++m)
+            {
+                board b2 = b;
+                int t2 = turn;
+            
+                state result = empty;
+                moves[m].apply(&b2, t2++, &result);
+                while (result==empty && t2<6*6)
+                {
+                    uniform_move(b2, t2, rng).apply(&b2, t2, &result);
+                    t2++;
+                }
+            
+                if (result==turntostate(turn))
+                    score[m]++;
+                else if (result==turntostate(turn+1))
+                    score[m]--;
+            }
+        }
+    
+        size_t best = 0;
+        for (size_t m=1;m!=moves.size();++m)
+        {
+            if (score[m]>score[best]) best = m;
+        }
+    
+        return moves[best];
+    }
+
+    // mcts adaptor for board_18 class
+    struct GameState
+    {
+        board mBoard;
+        int mTurn;
+        rollout_policy mRollout;
+        int mCutoff;
+        const tablebase* mTablebase;
+        
+        // the last move applied won on placement, and didn't rotate,
+        // only ever the last, as nothing follows a win
+        bool mSkippedRotation;
+    
+        // mBoard.winning(), kept up to date by Apply from the lines each move touches
+        state mWinning;
+    
+        GameState(board b, int t) : mBoard(b), mTurn(t), mRollout(uniform_rollout), mCutoff(0), mTablebase(0), mSkippedRotation(false), mWinning(b.winning()) {}
+        GameState() : mTurn(0), mRollout(uniform_rollout), mCutoff(0), mTablebase(0), mSkippedRotation(false), mWinning(empty) {}
+    
+        // the same position, for mcts::Tree::Advance
+        bool operator==( const GameState& rhs ) const { return mTurn==rhs.mTurn && mBoard==rhs.mBoard; }
+    
+        int GetCurrentPlayer() const { return mTurn & 1; }
+        int GetWinner() const { return ((int)mWinning)-1; }
+        bool Finished() const { return mWinning!=empty || mTurn==6*6; }
+    
+        // RAVE statistics are kept per placement position and rotation, as keys by position alone
+        // share one value across every rotation, hiding the differences between them
+        static const int amaf_keys = 6*6*8;
+        static int AmafKey( const pentago::move& move ) { return move.mP.get() + 6*6*move.mR.get(); }
+    
+        // used to guide pre-allocations for play out
+        // doesn't have to be 100% accurate, but
+        // over estimation == over allocation in setting a stack size
+        // under estimation == reallocates during a playouts to size the stack
+        int TurnsLeft() const { return (6*6)-mTurn; }
+    
+        int CountPossibleMoves() const
+        {
+            return (6*6*4*2)-mTurn;
+        }
+    
+        template< typename OutItr >
+        OutItr GetPossibleMoves(OutItr itr) const
+        {
+            return all_moves(mBoard, mTurn, itr);
+        }
+    
+        // for PUCT, by the heavy playout policy's weight of the position,
+        // an immediate win, or block, weighted as every other position together
+        void GetPriors( const pentago::move* moves, int n, float* priors ) const
+        {
+            int weight[6*6], win, block;
+            placement_weights(mBoard, line_counts(mBoard), mTurn, weight, &win, &block);
+            
+            int total = 0;
+            for (UInt i=0;i!=6*6;++i)
+                total += weight[i];
+            if (win>=0) weight[win] += total;
+            else if (block>=0) weight[block] += total;
+            
+            for (int i=0;i!=n;++i)
+                priors[i] = (float)weight[ moves[i].mP.get() ];
+        }
+    
+        GameState PlayMove( pentago::move move ) const
+        {
+            GameState result(*this);
+            result.Apply(move);
+            return result;
+        }
+    
+        // in place, for mcts to walk the tree without copying the state
+        void Apply( const pentago::move& move )
+        {
+            mSkippedRotation = !move.apply( &mBoard, mTurn++, &mWinning );
+        }
+    
+        void Undo( const pentago::move& move )
+        {
+            move.undo( &mBoard, !mSkippedRotation );
+            // moves are only ever played from unfinished positions
+            mSkippedRotation = false;
+            mWinning = empty;
+            --mTurn;
+        }
+    
+        // plays out to the end, or for mCutoff moves (when non-zero),
+        // after which the static evaluation decides the winner,
+        // or until the position is in mTablebase (when set), which decides it exactly,
+        // adding the moves played to played, when given
+        template< typename Rng >
+        int PlayRollout( Rng& rng, std::vector< pentago::move >* played=0 )
+        {
+            if (mRollout==uniform_rollout && mCutoff==0 && mTablebase==0)
+            {
+                while (Finished()==false)
+                {
+                    const pentago::move m = uniform_move(mBoard, mTurn, rng);
+                    Apply( m );
+                    if (played) played->push_back( m );
+                }
+                return GetWinner();
+            }
+        
+            line_counts counts(mBoard);
+            for (int n=0; Finished()==false; ++n)
+            {
+                if (n==mCutoff && mCutoff)
+                {
+                    const int e = counts.evaluate(white);
+                    return (e>0) ? 0 : (e<0) ? 1 : -1;
+                }
+            
+                if (mTablebase && TurnsLeft()<=tablebase_max_empties)
+                {
+                    const tablebase_result r = mTablebase->probe(mBoard);
+                    if (r==tb_win) return GetCurrentPlayer();
+                    if (r==tb_loss) return GetCurrentPlayer()^1;
+                    if (r==tb_draw) return -1;
+                }
+            
+                const state s = turntostate(mTurn);
+                pentago::move m = (mRollout==heuristic_rollout) 
+                    ? heuristic_move(mBoard, counts, mTurn, rng)
+                    : uniform_move(mBoard, mTurn, rng);
+                Apply( m );
+                counts.apply( m, s, mBoard );
+                if (played) played->push_back( m );
+            }
+            return GetWinner();
+        }
+    };
+
+    // fixed number of iterations, for repeatable searches
+    struct IterationTimeOut
+    {
+        IterationTimeOut(int n) : remaining(n) {}
+    
+        bool operator()()
+        {
+            return --remaining > 0;
+        }
+    
+        int remaining;
+    };
+}
+
+#endif
@@ -0,0 +1,22 @@
+// locklesstable.cpp
+
+#include "locklesstable.h"
+
+namespace pentago
+{
+    lockless_table::lockless_table( size_t bytes )
+    {
+        size_t entries = 1;
+        while (entries*2*2*sizeof(uint64_t) <= bytes)
+            entries *= 2;
+        mMask = entries-1;
+        mTable = std::vector< std::atomic< uint64_t > >( entries*2 );
+        clear();
+    }
+
+    void lockless_table::clear()
+    {
+        for (size_t i=0;i!=mTable.size();++i)
+            mTable[i].store( 0, std::memory_order_relaxed );
+    }
+}
@@ -0,0 +1,71 @@
+// locklesstable.h
+//
+// A fixed size hash table of 64 bit values by 64 bit key, shared between threads without locks.
+// Each entry is two words, the key xor the value, then the value, so an entry torn by
+// a simultaneous write fails to match its key rather than giving a wrong value.
+// A slot holds one entry, a store replacing whatever was there.
+
+#ifndef LOCKLESSTABLE_H_INCLUDED
+#define LOCKLESSTABLE_H_INCLUDED
+
+#include "pentago.h"
+
+#include <cstdint>
+#include <vector>
+#include <atomic>
+
+namespace pentago
+{
+    class lockless_table
+    {
+        public:
+            // as many entries as fit in bytes, a power of two, at least one
+            explicit lockless_table( size_t bytes );
+
+            size_t size() const
+            {
+                return mMask+1;
+            }
+
+            // every slot to the value 0 for the key 0
+            void clear();
+
+            bool probe( uint64_t key, uint64_t* value ) const
+            {
+                const size_t i = slot(key);
+                const uint64_t check = mTable[i].load( std::memory_order_relaxed );
+                const uint64_t data = mTable[i+1].load( std::memory_order_relaxed );
+                if ((check ^ data)!=key) return false;
+                *value = data;
+                return true;
+            }
+
+            // the value in key's slot, whichever key it was stored for
+            uint64_t held( uint64_t key ) const
+            {
+                return mTable[slot(key)+1].load( std::memory_order_relaxed );
+            }
+
+            void store( uint64_t key, uint64_t value )
+            {
+                const size_t i = slot(key);
+                mTable[i].store( key ^ value, std::memory_order_relaxed );
+                mTable[i+1].store( value, std::memory_order_relaxed );
+            }
+
+        private:
+            // not copyable
+            lockless_table( const lockless_table& );
+            lockless_table& operator=( const lockless_table& );
+
+            size_t slot( uint64_t key ) const
+            {
+                return ((size_t)hash_key(key) & mMask) * 2;
+            }
+
+            std::vector< std::atomic< uint64_t > > mTable;
+            size_t mMask;
+    };
+}
+
+#endif
@@ -1,11 +1,31 @@
 #include "pentago.h"
+#include "evaluate.h"
+#include "gamestate.h"
+#include "splitstate.h"
 #include "mcts.h"
+#include "tune.h"
+#include "book.h"
+#include "posdb.h"
+#include "tablebase.h"
+#include "proof.h"
+#include "alphabeta.h"
+#include "perft.h"
+#include "gamerecord.h"
+#include "tournament.h"
+#include "engine.h"
+#include "service.h"
 
 #include <cassert>
 #include <cstdio>
+#include <cstdlib>
 
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <sstream>
+#include <memory>
+#include <thread>
+#include <atomic>
 
 #include <iostream>
 
@@ -20,6 +40,28 @@ using namespace pentago;
 
 bool autoai[2] = {false, false};
 
+rollout_policy rollout = uniform_rollout;
+int rollout_cutoff = 0;
+mcts::Config mcts_config = engine_settings().mConfig;
+opening_book book;
+tablebase endgame;
+game_writer game_log;
+bool ponder = false;
+bool show_stats = false;
+bool split_turns = false;
+
+// proof-number search expansions looking for a forced win before each search, 0 for none
+int proof_nodes = 0;
+
+// the ai searches with alphabeta_search rather than mcts, on this many threads
+bool use_alphabeta = false;
+int alphabeta_threads = 1;
+
+// for each side, when the ai plays to a clock, otherwise it thinks for a second a move,
+// or up to three while the best move is unsettled
+bool clocked = false;
+mcts::GameClock ai_clock[2];
+
 string stringify(const board& b)
 {
     return tostring(b);
@@ -35,186 +77,162 @@ board create(const char * const v)
     return board::fromstring(v);
 }
 
-bool valid_move(const string& rhs)
-{
-    // valid moves are always 3 or 4 characters
-    if (rhs.length()<3) return false;
-    if (rhs.length()>4) return false;
-    
-    // Position [A-F][1-6]
-    if (toupper(rhs[0])>'F') return false;
-    if (toupper(rhs[0])<'A') return false;
-    if (rhs[1]>'6') return false;
-    if (rhs[1]<'1') return false;
-    
-    // Quadrant A,B,C, or D
-    if (toupper(rhs[2])>'D') return false;
-    if (toupper(rhs[2])<'A') return false;
-
-    // Direction (optional) + or -
-    if (rhs.length()==4 && (rhs[3]!='+' && rhs[3]!='-'))
-        return false;
-    
-    return true;
-}
+// white to move on turn 8, with an open four that four_win completes
+const board four = create(
+    "OOOO..\n"
+    "XX....\n"
+    "......\n"
+    "...X..\n"
+    "....X.\n"
+    "......\n");
+const position four_win(0,4);
 
-template< typename ItrOut >
-ItrOut all_moves(const board& b, int turn, ItrOut moves)
-{
-    // simple test for empty positions generator
-    empty_positions itr(b);
-    
-    while (itr.finished()==false)
-    {
-        position p = itr.get();
-        rotation r;
-        while (r.valid())
-        {
-            // filter out anti-clockwise rotations of symmetrical quadrants
-            if (r.get_direction()==rotation::clockwise ||
-                r.symetrical(&b)==false)
-            {
-                *moves++ = pentago::move( p, r );
-            }
-            r.next();
-        }
-        itr.next();
-    }
-    
-    return moves;
-}
-
-void all_moves(const board& b, int turn, vector< pentago::move >* moves)
+pentago::move ai(const board& b, int turn)
 {
-    moves->reserve( (6*6*4*2)-turn );
-    moves->resize( 0 );
-    all_moves(b, turn, std::back_inserter( *moves ));
+    mcts::Random rng;
+    return flat_move(b, turn, 128, rng);
 }
 
-pentago::move random_move(const board& b, int turn)
-{
-    static vector< pentago::move > moves;
-    all_moves(b, turn, &moves);
-    
-    return moves[rand()%moves.size()];
-}
+static const clock_t ticks_per_s = sysconf(_SC_CLK_TCK);
 
-pentago::move best_move(const board& b, int turn)
+struct OneSecondTimeOut
 {
-    vector< pentago::move > moves;
-    all_moves(b, turn, &moves);
-    
-    vector< int > score;
-    score.resize( moves.size() );
-
-    for (int s=0;s!=128;++s)
+    OneSecondTimeOut()
     {
-        for (int m=0;m!=moves.size();++m)
-        {
-            board b2 = b;
-            int t2 = turn;
-            
-            moves[m].apply(&b2, t2++);
-            while(b2.winning()==empty && t2<6*6)
-            {
-                random_move(b2,t2).apply(&b2,t2);
-                t2++;
-            }
-            
-            state result = b2.winning();
-            if (result==turntostate(turn))
-                score[m]++;
-            else if (result==turntostate(turn+1))
-                score[m]--;
-            
-        }
+        tms t;
+        currentTurnClockStart = times(&t);
     }
     
-    int best = 0;
-    for (int m=1;m!=moves.size();++m)
+    bool operator()()
     {
-        // cout << tostring(moves[m]) << " " << score[m] << endl;
-        if (score[m]>score[best]) best = m;
+        tms t;
+        dt = times(&t) - currentTurnClockStart;
+        return dt < ticks_per_s*2;
     }
     
-    return moves[best];
-}
+    clock_t dt, currentTurnClockStart;
+};
 
-pentago::move ai(const board& b, int turn)
+GameState search_state(const board& b, int turn)
 {
-    return best_move(b, turn);
+    GameState game(b,turn);
+    game.mRollout = rollout;
+    game.mCutoff = rollout_cutoff;
+    game.mTablebase = endgame.size() ? &endgame : 0;
+    return game;
 }
 
-// mcts adaptor for board_18 class
-struct GameState
+struct StopTimeOut
 {
-    board mBoard;
-    int mTurn;
-    
-    GameState(board b, int t) : mBoard(b), mTurn(t) {}
-    GameState() : mTurn(0) {}
-    
-    int GetCurrentPlayer() const { return mTurn & 1; }
-    int GetWinner() const { return ((int)mBoard.winning())-1; }
-    bool Finished() const { return mBoard.winning()!=empty || mTurn==6*6; }
-    
-    // used to guide pre-allocations for play out
-    // doesn't have to be 100% accurate, but
-    // over estimation == over allocation in setting a stack size
-    // under estimation == reallocates during a playouts to size the stack
-    int TurnsLeft() const { return (6*6)-mTurn; }
-    
-    int CountPossibleMoves() const
-    {
-        return (6*6*4*2)-mTurn;
-    }
+    StopTimeOut(const std::atomic<bool>* stop) : mStop(stop) {}
     
-    template< typename OutItr >
-    OutItr GetPossibleMoves(OutItr itr) const
+    bool operator()()
     {
-        return all_moves(mBoard, mTurn, itr);
+        return *mStop==false;
     }
     
-    GameState PlayMove( pentago::move move ) const
-    {
-        GameState result(*this);
-        move.apply( &result.mBoard, result.mTurn++ );
-        return result;
-    }
+    const std::atomic<bool>* mStop;
 };
 
-static const clock_t ticks_per_s = sysconf(_SC_CLK_TCK);
-
-struct OneSecondTimeOut
+// keeps the mcts tree from one move to the next,
+// and searches it on a background thread while the opponent thinks
+class ponderer
 {
-    OneSecondTimeOut()
+    public:
+        // without a node budget, pondering through a long think would use all the memory
+        static const size_t default_budget = 4000000;
+        
+        ponderer(const GameState& game)
+            : mArena( mcts_config.mNodeBudget ? mcts_config.mNodeBudget : default_budget )
+            , mTree( game, mcts_config, mArena )
+            , mStop(false)
+        { }
+        
+        ~ponderer()
+        {
+            stop();
+        }
+        
+        void start()
+        {
+            mStop = false;
+            mThread = std::thread( [this]() { mTree.Search( StopTimeOut(&mStop) ); } );
+        }
+        
+        void stop()
+        {
+            mStop = true;
+            if (mThread.joinable()) mThread.join();
+        }
+        
+        // only while stopped
+        mcts::Tree< pentago::move, GameState >& tree()
+        {
+            return mTree;
+        }
+        
+    private:
+        mcts::Arena< pentago::move > mArena;
+        mcts::Tree< pentago::move, GameState > mTree;
+        std::atomic<bool> mStop;
+        std::thread mThread;
+};
+
+pentago::move ai_mcts(const board& b, int turn, ponderer* pondering=0)
+{       
+    pentago::move m;
+    if (book.lookup(b, &m))
+        return m;
+    
+    tablebase_result result;
+    if (endgame.size() && 6*6-turn<=tablebase_max_empties &&
+        endgame.best_move(b, turn, &m, &result))
+        return m;
+    
+    if (proof_nodes && proven_win(b, turn, proof_nodes, &m))
+        return m;
+    
+    // a second a move, or up to three while the best move is unsettled
+    double target = 1, maximum = 3;
+    if (clocked) ai_clock[turn&1].Budget( (6*6-turn+1)/2, &target, &maximum );
+    mcts::TimeManager timer( target, maximum );
+    mcts::Stats< pentago::move > stats;
+    if (use_alphabeta)
+        m = alphabeta_search::GetMove( search_state(b, turn), timer, alphabeta_threads );
+    else if (pondering)
     {
-        tms t;
-        currentTurnClockStart = times(&t);
+        pondering->stop();
+        pondering->tree().Search( timer, show_stats ? &stats : 0 );
+        if (show_stats) pondering->tree().GetStats( &stats );
+        m = pondering->tree().BestMove();
     }
-    
-    bool operator()()
+    else
     {
-        tms t;
-        dt = times(&t) - currentTurnClockStart;
-        return dt < ticks_per_s*2;
+        mcts::Arena< pentago::move > arena( mcts_config.mNodeBudget );
+        if (split_turns)
+            m = split_move( search_state(b, turn), timer, mcts_config, arena, show_stats ? &stats : 0 );
+        else
+            m = mcts::Node< pentago::move >::GetMove( search_state(b, turn), timer, mcts_config, arena,
+                show_stats ? &stats : 0 );
     }
     
-    clock_t dt, currentTurnClockStart;
-};
-
-pentago::move ai_mcts(const board& b, int turn)
-{       
-    GameState game(b,turn);
-    
-    OneSecondTimeOut timer;
-    return mcts::Node< pentago::move >::GetMove( game, timer );
+    if (show_stats) cout << stats_json(stats) << endl;
+    if (clocked)
+    {
+        ai_clock[turn&1].Spend( timer.Elapsed() );
+        printf( "%.1fs thinking, %.1fs left\n", timer.Elapsed(), ai_clock[turn&1].Remaining() );
+    }
+    return m;
 }
 
 void interactive()
 {
     board b;
     int turn = 0;
+    game_record record;
+    
+    std::unique_ptr< ponderer > pondering;
+    if (ponder) pondering.reset( new ponderer( search_state(b, turn) ) );
     
     while (b.winning()==empty)
     {
@@ -236,18 +254,37 @@ void interactive()
             
             // quit
             if (movestr=="q" || movestr=="Q")
+            {
+                if (game_log.is_open()) game_log.append(record);
                 return;
+            }
                 
             if (movestr=="ai")
             {
-                movestr = tostring( ai_mcts(b, turn) );
+                movestr = tostring( ai_mcts(b, turn, pondering.get()) );
                 cout << "ai selects: " << movestr << endl;
             }
         }
         
-        move::fromstring(movestr.c_str()).apply( &b, turn++ );
+        const pentago::move m = move::fromstring(movestr.c_str());
+        m.apply( &b, turn++ );
+        record.mMoves.push_back(m);
+        
+        // on to the subtree of the move played, and think while the human does
+        if (pondering)
+        {
+            pondering->stop();
+            const int pondered = pondering->tree().Trials();
+            if (pondering->tree().Advance(m) && autoai[turn&1])
+                cout << "kept " << pondering->tree().Trials() << " of " << pondered << " playouts" << endl;
+            if (autoai[turn&1]==false && b.winning()==empty)
+                pondering->start();
+        }
     }
     
+    record.mWinner = ((int)b.winning())-1;
+    if (game_log.is_open()) game_log.append(record);
+    
     // show final board state
     printboard(b);
     
@@ -259,6 +296,69 @@ void interactive()
     cout << endl;
 }
 
+// position database builder tool, reads lines of:
+// board (6 rows of 6, each followed by any separator), move or -, visits, value
+void make_database(const char* path)
+{
+    position_database_builder builder;
+    
+    string boardstr, movestr;
+    unsigned visits;
+    int value;
+    while (cin >> boardstr >> movestr >> visits >> value)
+    {
+        if (boardstr.length()<6*7-1) continue;
+        
+        board b = board::fromstring(boardstr.c_str());
+        if (valid_move(movestr))
+        {
+            builder.add(b, move::fromstring(movestr.c_str()), visits, value);
+        }
+        else
+        {
+            UInt unused;
+            position_record r = { canonical(b, &unused), visits, (int16_t)value, position_record::no_move };
+            builder.add(r);
+        }
+    }
+    
+    size_t count = builder.size();
+    if (builder.write(path))
+        cout << count << " positions written to " << path << endl;
+    else
+        cout << "unable to write " << path << endl;
+}
+
+// position database reader tool, reads boards and prints what's known of them
+void query_database(const char* path)
+{
+    position_database db;
+    if (db.open(path)==false)
+    {
+        cout << "unable to open " << path << endl;
+        return;
+    }
+    
+    string boardstr;
+    while (cin >> boardstr)
+    {
+        if (boardstr.length()<6*7-1) continue;
+        
+        UInt symmetry;
+        const position_record* r = db.find(board::fromstring(boardstr.c_str()), &symmetry);
+        if (r==0)
+        {
+            cout << boardstr << " -" << endl;
+            continue;
+        }
+        
+        string movestr = "-";
+        if (r->mMove!=position_record::no_move)
+            movestr = tostring( transform(move::unpack(r->mMove), inverse_symmetry(symmetry)) );
+        cout << boardstr << " " << movestr << " " << r->mVisits << " " << r->mValue << endl;
+    }
+}
+
 void mcts_tests(bool verbose)
 {
     static vector< pentago::move > moves;
@@ -283,6 +383,1080 @@ void mcts_tests(bool verbose)
     OneSecondTimeOut timer;
     pentago::move m = mcts::Node< pentago::move >::GetMove( game, timer );
     printf( "%s\n", tostring(m).c_str() );
+    
+    // heavy playout policy takes the immediate win
+    mcts::Random rng;
+    m = heuristic_move(four, 8, rng);
+    assert( m.mP == four_win );
+    
+    // or blocks the opponents
+    board b = create(
+        "O.....\n"
+        "XXXX..\n"
+        "...O..\n"
+        "......\n"
+        "....O.\n"
+        ".....O\n");
+    m = heuristic_move(b, 8, rng);
+    assert( m.mP == position(1,4) );
+    
+    // heavy playouts convert the win
+    game = GameState( four, 8 );
+    game.mRollout = heuristic_rollout;
+    assert( GameState(game).PlayRollout(rng)==0 );
+    
+    // truncated playouts, called by the static evaluation
+    GameState truncated = game;
+    truncated.mCutoff = 1;
+    assert( truncated.PlayRollout(rng)==0 );
+    truncated = GameState();
+    truncated.mCutoff = 4;
+    truncated.PlayRollout(rng);
+    assert( truncated.mTurn==4 );
+    
+    // single node expansion, finishing with heavy playouts
+    m = mcts::Node< pentago::move >::GetMove( game, IterationTimeOut(2000) );
+    if (verbose) printf( "%s\n", tostring(m).c_str() );
+    assert( game.mBoard.get(m.mP)==empty );
+    
+    // leaves only expanded after repeated visits
+    mcts::Config config;
+    config.mExpandThreshold = 4;
+    m = mcts::Node< pentago::move >::GetMove( game, IterationTimeOut(2000), config );
+    assert( game.mBoard.get(m.mP)==empty );
+    
+    // memory bounded search, recycling the least visited subtrees
+    config.mNodeBudget = 20000;
+    {
+        mcts::Arena< pentago::move > arena( config.mNodeBudget );
+        m = mcts::Node< pentago::move >::GetMove( game, IterationTimeOut(4000), config, arena );
+        if (verbose) printf( "peak %i, recycled %i\n", (int)arena.Peak(), (int)arena.Recycled() );
+        assert( game.mBoard.get(m.mP)==empty );
+        assert( arena.Peak() <= config.mNodeBudget );
+        assert( arena.Recycled() > 0 );
+        assert( arena.Live() == 0 );
+    }
+    
+    // or just stopping expansion when the budget is reached
+    config.mRecycle = false;
+    {
+        mcts::Arena< pentago::move > arena( config.mNodeBudget );
+        m = mcts::Node< pentago::move >::GetMove( game, IterationTimeOut(4000), config, arena );
+        assert( game.mBoard.get(m.mP)==empty );
+        assert( arena.Peak() <= config.mNodeBudget );
+        assert( arena.Recycled() == 0 );
+    }
+    config.mNodeBudget = 0;
+    
+    // blending in all-moves-as-first statistics, recording the rollouts' moves
+    static_assert( mcts::HasAmaf< GameState, pentago::move >::value, "GameState supports RAVE" );
+    {
+        vector< pentago::move > played;
+        GameState recorded;
+        const int winner = recorded.PlayRollout(rng, &played);
+        assert( (int)played.size()==recorded.mTurn && winner==recorded.GetWinner() );
+        
+        config.mRave = 50;
+        m = mcts::Node< pentago::move >::GetMove( GameState(four, 8), IterationTimeOut(2000), config );
+        assert( m.mP==four_win );
+        config.mRave = 0;
+    }
+    
+    // each selection policy, and final move rule, takes the immediate win
+    {
+        vector< pentago::move > moves;
+        GameState won(four, 8);
+        won.GetPossibleMoves( std::back_inserter(moves) );
+        vector< float > priors( moves.size() );
+        won.GetPriors( &moves[0], (int)moves.size(), &priors[0] );
+        for (size_t i=0;i!=moves.size();++i)
+            assert( (priors[i] > 50) == (moves[i].mP==four_win) );
+        
+        const mcts::Selection selections[] = { mcts::SelectUcb1, mcts::SelectUcb1Tuned, mcts::SelectPuct };
+        const mcts::FinalMove finals[] = { mcts::FinalVisits, mcts::FinalRatio, mcts::FinalSecure };
+        for (int s=0;s!=3;++s)
+        {
+            for (int f=0;f!=3;++f)
+            {
+                config.mSelection = selections[s];
+                config.mFinal = finals[f];
+                config.mMinVisits = 10;
+                m = mcts::Node< pentago::move >::GetMove( won, IterationTimeOut(2000), config );
+                assert( m.mP==four_win );
+            }
+        }
+        config = mcts::Config();
+    }
+    
+    // a settled search stops long before its target
+    {
+        mcts::Arena< pentago::move > arena;
+        mcts::Tree< pentago::move, SplitGameState > tree( GameState(four, 8), mcts::Config(), arena );
+        mcts::TimeManager timer( 5, 10 );
+        tree.Search( timer );
+        assert( timer.StoppedEarly() && timer.Elapsed() < 4 && timer.Iterations()>0 );
+        assert( tree.BestMove().mP==four_win );
+        
+        int most, second;
+        assert( tree.MostVisited( &most, &second )>=0 && most>second );
+    }
+    
+    // and the clock shares out the game's time
+    {
+        mcts::GameClock clock( 60, 1 );
+        double target, maximum;
+        clock.Budget( 10, &target, &maximum );
+        assert( target==7 && maximum==21 );
+        clock.Spend( 11 );
+        assert( clock.Remaining()==50 );
+        clock.Budget( 1, &target, &maximum );
+        assert( maximum==25 && target==25 );
+    }
+    
+    // UCB1-Tuned explores less than UCB1 where the results vary less
+    assert( mcts::Ucb1Tuned(100)( 0.9f, 10, 0 ) < mcts::Ucb1(mcts::uct_c, 100)( 0.9f, 10, 0 ) );
+    // and PUCT explores the likelier moves first
+    assert( mcts::Puct(mcts::uct_c, 100).Unvisited( 0.5f ) > mcts::Puct(mcts::uct_c, 100).Unvisited( 0.1f ) );
+    
+    // and the original, expand everything, search
+    config.mExpandOne = false;
+    m = mcts::Node< pentago::move >::GetMove( game, IterationTimeOut(200), config );
+    assert( game.mBoard.get(m.mP)==empty );
+    
+    // moves played and taken back in place, including a winning placement's skipped rotation
+    static_assert( mcts::HasApplyUndo< GameState, pentago::move >::value, "GameState plays in place" );
+    static_assert( !mcts::HasApplyUndo< pentago::board, pentago::move >::value, "board doesn't" );
+    for (int g=0;g!=256;++g)
+    {
+        GameState played;
+        vector<GameState> history;
+        vector<pentago::move> moves;
+        while (played.Finished()==false)
+        {
+            history.push_back(played);
+            moves.push_back( uniform_move(played.mBoard, played.mTurn, rng) );
+            played.Apply( moves.back() );
+            assert( played==history.back().PlayMove(moves.back()) );
+            assert( played.mWinning==played.mBoard.winning() );
+        }
+        while (moves.empty()==false)
+        {
+            played.Undo( moves.back() );
+            assert( played==history.back() );
+            moves.pop_back();
+            history.pop_back();
+        }
+    }
+    
+    // each turn as a placement then a rotation, the same games as whole moves
+    static_assert( mcts::HasApplyUndo< SplitGameState, pentago::move >::value, "SplitGameState plays in place" );
+    for (int g=0;g!=32;++g)
+    {
+        GameState whole;
+        SplitGameState split;
+        vector<SplitGameState> history;
+        vector<pentago::move> halves;
+        while (whole.Finished()==false)
+        {
+            vector<pentago::move> moves;
+            split.GetPossibleMoves( std::back_inserter(moves) );
+            assert( (int)moves.size()==split.CountPossibleMoves() );
+            const pentago::move place = moves[ rng(moves.size()) ];
+            history.push_back(split);
+            halves.push_back(place);
+            split.Apply(place);
+            
+            moves.clear();
+            if (split.Finished()==false)
+            {
+                split.GetPossibleMoves( std::back_inserter(moves) );
+                assert( moves.size()>=4 && (int)moves.size()<=split.CountPossibleMoves() );
+                history.push_back(split);
+                halves.push_back( moves[ rng(moves.size()) ] );
+                split.Apply( halves.back() );
+            }
+            
+            whole.Apply( halves.back() );
+            assert( whole==split.mGame && whole.mWinning==split.mGame.mWinning );
+            assert( split.mRotating==false || split.Finished() );
+        }
+        while (halves.empty()==false)
+        {
+            split.Undo( halves.back() );
+            assert( split==history.back() );
+            halves.pop_back();
+            history.pop_back();
+        }
+    }
+    
+    // and searched as such
+    {
+        mcts::Arena< pentago::move > arena;
+        m = split_move( GameState(four, 8), IterationTimeOut(2000), mcts::Config(), arena );
+        assert( m.mP==four_win );
+        m = split_move( GameState(), IterationTimeOut(2000), mcts::Config(), arena );
+        assert( arena.Live()==0 );
+    }
+    
+    b = four;
+    state winner = empty;
+    assert( move::fromstring("A5B+").apply(&b, 8, &winner)==false );
+    assert( b.winning()==white && winner==white );
+    assert( b.winning_through(four_win)==white );
+    move::fromstring("A5B+").undo(&b, false);
+    assert( b==four );
+    
+    // what the search did
+    config = mcts::Config();
+    {
+        mcts::Arena< pentago::move > arena;
+        mcts::Stats< pentago::move > stats;
+        m = mcts::Node< pentago::move >::GetMove( GameState(), IterationTimeOut(1000), config, arena, &stats );
+        assert( stats.mIterations==1000 );
+        assert( stats.mMaxDepth>=2 );
+        assert( stats.mNodes>0 && stats.mNodes<=stats.mPeakNodes );
+        assert( stats.mBytes>=stats.mPeakNodes*sizeof(mcts::Node< pentago::move >) );
+        assert( stats.mSelect>0 && stats.mExpand>0 && stats.mPlayout>0 && stats.mBackprop>0 );
+        
+        int visits = 0;
+        int most = 0;
+        for (size_t i=0;i!=stats.mRoot.size();++i)
+        {
+            visits += stats.mRoot[i].mVisits;
+            most = std::max( most, stats.mRoot[i].mVisits );
+        }
+        assert( stats.mRoot.size()==(size_t)GameState().CountPossibleMoves()/2 );
+        assert( visits==1000 );
+        assert( stats.mPV.size()>=2 );
+        
+        const string json = stats_json(stats);
+        if (verbose) printf( "%.200s...\n", json.c_str() );
+        assert( json.find("\"iterations\":1000,")!=string::npos );
+        assert( json.find("\"pv\":[\"" + tostring(stats.mPV[0]) + "\"")!=string::npos );
+    }
+    
+    // a tree kept between moves, searching on through the opponent's turn
+    {
+        mcts::Arena< pentago::move > arena;
+        mcts::Tree< pentago::move, GameState > tree( GameState(), config, arena );
+        tree.Search( IterationTimeOut(3000) );
+        assert( tree.Trials()==3000 );
+        
+        m = tree.BestMove();
+        assert( tree.Advance(m) );
+        assert( tree.Game().mTurn==1 );
+        
+        // the subtree searched under our move is kept, and grows
+        const int kept = tree.Trials();
+        assert( kept > 0 );
+        tree.Search( IterationTimeOut(1000) );
+        assert( tree.Trials()==kept+1000 );
+        
+        // the opponent's reply, by a move reaching the same position, if not the same move
+        pentago::move reply = tree.BestMove();
+        if (reply.mR.symetrical(&tree.Game().mBoard))
+            reply.mR = rotation( reply.mR.get_quadrant(), rotation::anticlockwise );
+        assert( tree.Advance(reply) );
+        assert( tree.Game().mTurn==2 );
+        assert( tree.Game().mBoard.get(tree.BestMove().mP)==empty );
+        
+    }
+    
+    // a move the tree hasn't searched starts it again
+    {
+        mcts::Arena< pentago::move > arena;
+        mcts::Tree< pentago::move, GameState > tree( GameState(), config, arena );
+        assert( tree.Advance( move::fromstring("C3A+") )==false );
+        assert( tree.Game().mTurn==1 && tree.Trials()==0 );
+        tree.Search( IterationTimeOut(100) );
+        assert( tree.Game().mBoard.get(tree.BestMove().mP)==empty );
+    }
+}
+
+void evaluate_tests(bool verbose)
+{
+    // incremental line counts agree with counting from scratch
+    mcts::Random rng;
+    for (int g=0;g!=16;++g)
+    {
+        board b;
+        line_counts counts;
+        for (int turn=0; b.winning()==empty && turn!=6*6; ++turn)
+        {
+            pentago::move m = uniform_move(b, turn, rng);
+            m.apply(&b, turn);
+            counts.apply(m, turntostate(turn), b);
+            
+            const line_counts fresh(b);
+            for (UInt l=0;l!=line_count;++l)
+            {
+                assert( counts.count(l, white)==fresh.count(l, white) );
+                assert( counts.count(l, black)==fresh.count(l, black) );
+            }
+            for (int f=0;f!=feature_count;++f)
+            {
+                assert( counts.features(white, (feature)f)==fresh.features(white, (feature)f) );
+                assert( counts.features(black, (feature)f)==fresh.features(black, (feature)f) );
+            }
+            assert( counts.evaluate(white)==-counts.evaluate(black) );
+        }
+        if (verbose) printboard(b);
+    }
+    
+    board b = four;
+    line_counts counts(b);
+    assert( counts.features(white, open_4)==1 );
+    assert( counts.features(white, blocked_4)==0 );
+    assert( counts.features(black, open_2)>0 );
+    assert( evaluate(b, white) > 0 );
+    
+    // placing and removing a stone restores the counts
+    counts.place( four_win, black );
+    assert( counts.features(white, open_4)==0 );
+    assert( counts.features(white, blocked_4)==1 );
+    counts.remove( four_win, black );
+    assert( counts.evaluate(white)==evaluate(b, white) );
+}
+
+void tune_tests(bool verbose)
+{
+    // white wins when it's ahead on open threes, less for being ahead on blocked threes
+    vector<tune_sample> samples;
+    for (int i=0;i!=100;++i)
+    {
+        tune_sample s = { { 0 }, 0 };
+        s.mX[open_3] = (int16_t)(i%5 - 2);
+        s.mX[blocked_3] = (int16_t)((i/5)%5 - 2);
+        const int ahead = 2*s.mX[open_3] - s.mX[blocked_3];
+        s.mResult = (ahead>0) ? 1.0f : (ahead<0) ? 0.0f : 0.5f;
+        samples.push_back(s);
+    }
+    
+    double w[feature_count] = { 0 };
+    const double before = log_loss(samples, w);
+    fit_weights(samples, 200, w);
+    assert( log_loss(samples, w) < before );
+    assert( w[open_3]>0 && w[blocked_3]<0 && w[open_3]>-w[blocked_3] );
+    
+    // features that never differ are left alone
+    assert( w[open_2]==0 && w[open_4]==0 );
+    
+    if (verbose) printf("tune tests passed\n");
+}
+
+void book_tests(bool verbose)
+{
+    mcts::Random rng;
+    
+    // packed boards, quadrants in base 3, positions in order of x then y
+    static const position corner[4] = { position(0,0), position(0,3), position(3,0), position(3,3) };
+    for (int g=0;g!=8;++g)
+    {
+        board b;
+        for (int turn=0; b.winning()==empty && turn!=6*6; ++turn)
+        {
+            uint64_t expected = 0;
+            for (UInt q=0;q!=4;++q)
+            {
+                uint64_t v = 0;
+                for (UInt i=9;i--;)
+                    v = v*3 + b.get( corner[q] + position(i%3, i/3) );
+                expected |= v << (15*q);
+            }
+            assert( pack(b)==expected );
+            assert( pack(b) < (1ull << 60) );
+            assert( unpack(pack(b))==b );
+            
+            uniform_move(b, turn, rng).apply(&b, turn);
+        }
+    }
+    
+    // 16 bit move encoding
+    for (int i=0;i!=6*6*8;++i)
+    {
+        pentago::move m( position(i%36), rotation(i/36) );
+        assert( pentago::move::unpack(m.pack()).pack()==m.pack() );
+        assert( tostring(pentago::move::unpack(m.pack()))==tostring(m) );
+    }
+    
+    // symmetries commute with play, and all give the same canonical key
+    for (int g=0;g!=8;++g)
+    {
+        board b;
+        for (int turn=0; b.winning()==empty && turn!=6*6; ++turn)
+        {
+            pentago::move m = uniform_move(b, turn, rng);
+            
+            UInt symmetry;
+            const uint64_t key = canonical(b, &symmetry);
+            assert( pack(transform(b, symmetry))==key );
+            
+            for (UInt s=0;s!=symmetry_count;++s)
+            {
+                board t = transform(b, s);
+                assert( transform(t, inverse_symmetry(s))==b );
+                
+                UInt unused;
+                assert( canonical(t, &unused)==key );
+                
+                board after = b;
+                m.apply(&after, turn);
+                transform(m, s).apply(&t, turn);
+                assert( t==transform(after, s) );
+            }
+            
+            m.apply(&b, turn);
+        }
+    }
+    
+    // book answers for every orientation of its positions
+    opening_book testbook;
+    board b = create(
+        "......\n"
+        ".O....\n"
+        "......\n"
+        "....X.\n"
+        "......\n"
+        "......\n");
+    pentago::move m = move::fromstring("A1B-");
+    testbook.add(b, m);
+    assert( testbook.size()==1 );
+    for (UInt s=0;s!=symmetry_count;++s)
+    {
+        pentago::move found;
+        assert( testbook.lookup(transform(b, s), &found) );
+        assert( found.pack()==transform(m, s).pack() );
+    }
+    pentago::move unused;
+    assert( testbook.lookup(board(), &unused)==false );
+    
+    // and builds from searches of the first plies
+    book_settings settings;
+    settings.mPlies = 1;
+    settings.mPlayouts = 1000;
+    settings.mThreads = 1;
+    settings.mProgress = false;
+    opening_book built;
+    build_book(settings, &built);
+    assert( built.size()==1 );
+    assert( built.lookup(board(), &m) );
+    if (verbose) printf( "book opening: %s\n", tostring(m).c_str() );
+}
+
+void posdb_tests(bool verbose)
+{
+    char path[] = "/tmp/pentago_posdb_XXXXXX";
+    int fd = mkstemp(path);
+    assert( fd>=0 );
+    close(fd);
+    
+    // every table size up to a few levels of the tree,
+    // finds each key present, and none of those absent
+    for (int n=0;n!=40;++n)
+    {
+        position_database_builder builder;
+        for (int i=0;i!=n;++i)
+        {
+            position_record r = { (uint64_t)i*2+1, (uint32_t)i, (int16_t)-i, (uint16_t)i };
+            builder.add(r);
+        }
+        assert( builder.write(path) );
+        
+        position_database db;
+        assert( db.open(path) );
+        assert( db.size()==(uint64_t)n );
+        for (int i=0;i!=n;++i)
+        {
+            const position_record* r = db.find( (uint64_t)i*2+1 );
+            assert( r && r->mVisits==(uint32_t)i && r->mValue==-i );
+        }
+        for (int i=0;i<=n;++i)
+            assert( db.find( (uint64_t)i*2 )==0 );
+        assert( db.find( UINT64_MAX )==0 );
+    }
+    
+    // boards are found in any orientation, duplicates merged
+    board b = create(
+        "......\n"
+        ".O....\n"
+        "......\n"
+        "....X.\n"
+        "......\n"
+        "......\n");
+    position_database_builder builder;
+    builder.add( b, move::fromstring("A1B-"), 10, 100 );
+    builder.add( transform(b, 5), transform(move::fromstring("C3D+"), 5), 30, 200 );
+    assert( builder.size()==1 );
+    assert( builder.write(path) );
+    
+    position_database db;
+    assert( db.open(path) );
+    for (UInt s=0;s!=symmetry_count;++s)
+    {
+        UInt symmetry;
+        const position_record* r = db.find( transform(b, s), &symmetry );
+        assert( r );
+        assert( r->mVisits==40 );
+        assert( r->mValue==175 );
+        assert( transform(move::unpack(r->mMove), inverse_symmetry(symmetry)).pack() == 
+            transform(move::fromstring("C3D+"), s).pack() );
+    }
+    db.close();
+    
+    // books are stored in the same format
+    opening_book saved, loaded;
+    saved.add( b, move::fromstring("A1B-") );
+    assert( saved.save(path) );
+    assert( loaded.load(path) );
+    pentago::move m;
+    assert( loaded.lookup(transform(b, 3), &m) );
+    assert( m.pack()==transform(move::fromstring("A1B-"), 3).pack() );
+    
+    unlink(path);
+    if (verbose) printf("posdb tests passed\n");
+}
+
+// exhaustive negamax, for checking the tablebase
+tablebase_result solve(const board& b, int turn)
+{
+    vector<pentago::move> moves;
+    all_moves(b, turn, &moves);
+    
+    tablebase_result best = tb_loss;
+    for (size_t i=0;i!=moves.size();++i)
+    {
+        board c = b;
+        moves[i].apply(&c, turn);
+        
+        tablebase_result r = terminal_result(c, turn);
+        if (r==tb_unknown)
+        {
+            r = solve(c, turn+1);
+            r = (r==tb_win) ? tb_loss : (r==tb_loss) ? tb_win : tb_draw;
+        }
+        if (r==tb_win) return r;
+        if (r==tb_draw) best = r;
+    }
+    return best;
+}
+
+void tablebase_tests(bool verbose)
+{
+    // five in a row for the player who just moved, or both
+    board b = create(
+        "XXXXX.\n"
+        "OOOO..\n"
+        "......\n"
+        "......\n"
+        "......\n"
+        "......\n");
+    assert( terminal_result(b, 9)==tb_win );
+    assert( terminal_result(b, 8)==tb_loss );
+    b.set(position(1,4), white);
+    assert( terminal_result(b, 9)==tb_draw );
+    assert( terminal_result(board(), 0)==tb_unknown );
+    
+    char path[] = "/tmp/pentago_tb_XXXXXX";
+    int fd = mkstemp(path);
+    assert( fd>=0 );
+    close(fd);
+    
+    tablebase_settings settings;
+    settings.mEmpties = 3;
+    settings.mSeeds = 4;
+    settings.mThreads = 2;
+    settings.mProgress = false;
+    
+    vector<board> seeds = tablebase_seeds(settings);
+    assert( seeds.empty()==false );
+    assert( build_tablebase(settings, seeds, path) >= seeds.size() );
+    
+    tablebase tb;
+    assert( tb.open(path) );
+    
+    // agrees with a search, in every orientation, and plays to its result
+    const int turn = 6*6-settings.mEmpties;
+    for (size_t i=0;i!=seeds.size();++i)
+    {
+        const tablebase_result r = solve(seeds[i], turn);
+        for (UInt s=0;s!=symmetry_count;++s)
+            assert( tb.probe(transform(seeds[i], s))==r );
+        
+        pentago::move m;
+        tablebase_result result;
+        assert( tb.best_move(seeds[i], turn, &m, &result) );
+        assert( result==r );
+        
+        if (verbose) 
+            printf("tablebase seed %i: %s, %s\n", (int)i, tostring(m).c_str(), 
+                r==tb_win ? "win" : r==tb_draw ? "draw" : "loss");
+    }
+    assert( tb.probe(board())==tb_unknown );
+    
+    // a winning placement is found off the table, the other moves leading nowhere in it
+    pentago::move m;
+    tablebase_result result;
+    assert( tb.best_move(four, 8, &m, &result) && result==tb_win && m.mP==four_win );
+    assert( tb.best_move(board(), 0, &m, &result)==false );
+    
+    // rollouts stop on reaching it
+    GameState game(seeds[0], turn);
+    game.mTablebase = &tb;
+    mcts::Random rng;
+    const int winner = game.PlayRollout(rng);
+    const tablebase_result r = tb.probe(seeds[0]);
+    assert( game.mTurn==turn );
+    assert( winner == (r==tb_draw ? -1 : r==tb_win ? (turn&1) : (turn&1)^1) );
+    
+    unlink(path);
+    if (verbose) printf("tablebase tests passed (%i positions)\n", (int)tb.size());
+}
+
+void proof_tests(bool verbose)
+{
+    // the immediate win, one move long
+    proof_search search( 1 << 20 );
+    vector<pentago::move> line;
+    assert( search.solve(four, 8, 1000, 0, &line)==tb_win );
+    assert( line.size()==1 && line[0].mP==four_win );
+    
+    pentago::move m;
+    assert( proven_win(four, 8, 1000, &m) && m.mP==four_win );
+    
+    // agrees with exhaustive search on late positions, and plays to its result
+    tablebase_settings settings;
+    settings.mEmpties = 4;
+    settings.mSeeds = 8;
+    const vector<board> seeds = tablebase_seeds(settings);
+    const int turn = 6*6-settings.mEmpties;
+    proof_search small( 1 << 10 );
+    for (size_t i=0;i!=seeds.size();++i)
+    {
+        const tablebase_result r = search.solve(seeds[i], turn, 0, 0, &line);
+        assert( r==solve(seeds[i], turn) );
+        assert( line.empty()==false );
+        
+        // a table far smaller than the search only makes it slower
+        assert( small.solve(seeds[i], turn)==r );
+        
+        // the line ends the game, with the result proven
+        board b = seeds[i];
+        int t = turn;
+        state winner = empty;
+        for (size_t n=0; n!=line.size(); ++n)
+        {
+            assert( winner==empty && b.get(line[n].mP)==empty );
+            line[n].apply(&b, t++, &winner);
+        }
+        if (r==tb_win) assert( winner==turntostate(turn) );
+        if (r==tb_loss) assert( winner==turntostate(turn+1) );
+        if (r==tb_draw) assert( winner==invalid || (winner==empty && t==6*6) );
+    }
+    
+    // out of budget before anything is proven
+    board b = create(
+        "O.....\n"
+        "XXXX..\n"
+        "...O..\n"
+        "......\n"
+        "....O.\n"
+        ".....O\n");
+    assert( search.solve(b, 8, 10, 0, &line)==tb_unknown && line.empty() );
+    assert( search.nodes()==10 );
+    
+    if (verbose) printf("proof tests passed\n");
+}
+
+void alphabeta_tests(bool verbose)
+{
+    // takes the immediate win
+    pentago::move m = alphabeta_search::GetMove( GameState(four, 8), IterationTimeOut(1000) );
+    assert( m.mP==four_win );
+    
+    // and stops the opponent's, by blocking it or rotating it apart
+    board b = create(
+        "O.....\n"
+        "XXXX..\n"
+        "...O..\n"
+        "......\n"
+        "....O.\n"
+        ".....O\n");
+    alphabeta_search search;
+    IterationTimeOut nodes(20000);
+    m = search.search( b, 8, nodes );
+    assert( search.nodes()<=20000 && search.depth()>=2 );
+    m.apply(&b, 8);
+    vector<pentago::move> replies;
+    all_moves(b, 9, &replies);
+    for (size_t i=0;i!=replies.size();++i)
+    {
+        board c = b;
+        state winner = empty;
+        replies[i].apply(&c, 9, &winner);
+        assert( winner!=black );
+    }
+    
+    // agrees with exhaustive search when it sees to the end of the game
+    tablebase_settings settings;
+    settings.mEmpties = 3;
+    settings.mSeeds = 8;
+    const vector<board> seeds = tablebase_seeds(settings);
+    const int turn = 6*6-settings.mEmpties;
+    for (size_t i=0;i!=seeds.size();++i)
+    {
+        m = search.search( seeds[i], turn, IterationTimeOut(1 << 30) );
+        const tablebase_result r = solve(seeds[i], turn);
+        assert( search.score()>0 ? r==tb_win : search.score()<0 ? r==tb_loss : r==tb_draw );
+        
+        // as do helper threads, sharing the table
+        alphabeta_search parallel( alphabeta_search::default_table_bytes, 3 );
+        parallel.search( seeds[i], turn, IterationTimeOut(1 << 30) );
+        assert( parallel.threads()==3 && parallel.score()==search.score() );
+        
+        // and plays to that result
+        board c = seeds[i];
+        m.apply(&c, turn);
+        const tablebase_result after = terminal_result(c, turn);
+        assert( after==r || (after==tb_unknown && solve(c, turn+1)==(r==tb_win ? tb_loss : r==tb_loss ? tb_win : tb_draw)) );
+    }
+    
+    if (verbose) printf("alphabeta tests passed\n");
+}
+
+void perft_tests(bool verbose)
+{
+    // from the empty board, where every quadrant is symmetrical, only the clockwise rotations are generated
+    perft_settings settings;
+    settings.mThreads = 1;
+    settings.mDepth = 0;
+    assert( perft(board(), 0, settings).mLeaves==1 );
+    settings.mDepth = 1;
+    perft_result r = perft(board(), 0, settings);
+    assert( r.mLeaves==6*6*4 && r.mNodes==6*6*4 );
+    
+    // reaching a stone on any of the 36 positions, of which 6 differ under symmetry
+    settings.mMode = perft_positions;
+    assert( perft(board(), 0, settings).mLeaves==6*6 );
+    settings.mMode = perft_symmetric;
+    assert( perft(board(), 0, settings).mLeaves==6 );
+    
+    // the known totals, which the table and the threads count the same
+    settings.mMode = perft_moves;
+    settings.mDepth = 2;
+    assert( perft(board(), 0, settings).mLeaves==24640 );
+    settings.mDepth = 3;
+    assert( perft(board(), 0, settings).mLeaves==4704512 );
+    settings.mHashBytes = 1 << 20;
+    assert( perft(board(), 0, settings).mLeaves==4704512 );
+    settings.mThreads = 3;
+    assert( perft(board(), 0, settings).mLeaves==4704512 );
+    settings.mHashBytes = 0;
+    assert( perft(board(), 0, settings).mLeaves==4704512 );
+    
+    // which reach every placement of the stones, 36*35 and 36*35/2*34,
+    // fewer under symmetry (by Burnside's lemma, 165 for the first two)
+    settings.mMode = perft_positions;
+    settings.mDepth = 2;
+    assert( perft(board(), 0, settings).mLeaves==6*6*35 );
+    settings.mDepth = 3;
+    assert( perft(board(), 0, settings).mLeaves==6*6*35/2*34 );
+    settings.mMode = perft_symmetric;
+    settings.mDepth = 2;
+    assert( perft(board(), 0, settings).mLeaves==165 );
+    
+    // finished games count towards no deeper total, and end the count at a finished position
+    settings.mMode = perft_moves;
+    settings.mThreads = 1;
+    const uint64_t ones = perft(four, 8, settings).mLeaves;
+    vector<pentago::move> moves;
+    all_moves(four, 8, &moves);
+    uint64_t expected = 0;
+    for (size_t i=0;i!=moves.size();++i)
+    {
+        board c = four;
+        state winner = empty;
+        moves[i].apply(&c, 8, &winner);
+        if (winner!=empty) continue;
+        vector<pentago::move> replies;
+        all_moves(c, 9, &replies);
+        expected += replies.size();
+    }
+    assert( ones==expected );
+    board won = four;
+    pentago::move(four_win, rotation(rotation::D, rotation::clockwise)).apply(&won, 8);
+    assert( won.winning()==white && perft(won, 9, settings).mLeaves==0 );
+    
+    if (verbose) printf("perft tests passed\n");
+}
+
+void gamerecord_tests(bool verbose)
+{
+    char path[] = "/tmp/pentago_games_XXXXXX";
+    int fd = mkstemp(path);
+    assert( fd>=0 );
+    close(fd);
+    unlink(path);
+    
+    // random games, written across two sessions
+    mcts::Random rng;
+    vector<game_record> games;
+    for (int n=0;n!=20;++n)
+    {
+        GameState game;
+        game_record g;
+        for (int i=0; game.Finished()==false && i!=n*2; ++i)
+        {
+            g.mMoves.push_back( uniform_move(game.mBoard, game.mTurn, rng) );
+            game = game.PlayMove( g.mMoves.back() );
+        }
+        if (game.Finished()) g.mWinner = game.GetWinner();
+        games.push_back(g);
+    }
+    
+    game_writer writer;
+    assert( writer.open(path) );
+    for (int n=0;n!=10;++n)
+        assert( writer.append(games[n]) );
+    writer.close();
+    assert( writer.open(path) );
+    for (int n=10;n!=20;++n)
+        assert( writer.append(games[n]) );
+    writer.close();
+    
+    game_reader reader;
+    assert( reader.open(path) );
+    game_record g;
+    for (int n=0;n!=20;++n)
+    {
+        assert( reader.next(&g) );
+        assert( g.mWinner==games[n].mWinner );
+        assert( g.mMoves.size()==games[n].mMoves.size() );
+        for (size_t i=0;i!=g.mMoves.size();++i)
+            assert( g.mMoves[i].pack()==games[n].mMoves[i].pack() );
+        assert( g.final_board()==games[n].final_board() );
+    }
+    assert( reader.next(&g)==false );
+    reader.close();
+    
+    // other files are refused
+    FILE* f = fopen(path, "wb");
+    fputs("PDB1", f);
+    fclose(f);
+    assert( reader.open(path)==false );
+    
+    unlink(path);
+    if (verbose) printf("game record tests passed\n");
+}
+
+void tournament_tests(bool verbose)
+{
+    engine_settings e;
+    assert( e.parse("random") && e.mKind==random_engine );
+    assert( e.parse("flat:16") && e.mKind==flat_engine && e.mPlayouts==16 );
+    assert( e.parse("mcts:500:heavy") && e.mKind==mcts_engine && e.mPlayouts==500 );
+    assert( e.mRollout==heuristic_rollout && e.name()=="mcts:500:heavy" );
+    assert( e.parse("mcts") && e.mPlayouts==500 );
+    assert( e.parse("mcts:500:heavy:rave") && e.mConfig.mRave>0 && e.name()=="mcts:500:heavy:rave" );
+    assert( e.parse("mcts:500:raver")==false );
+    assert( e.parse("mcts:500:tuned:secure") && e.mConfig.mSelection==mcts::SelectUcb1Tuned );
+    assert( e.mConfig.mFinal==mcts::FinalSecure && e.name()=="mcts:500:heavy:rave:tuned:secure" );
+    assert( e.parse("mcts:500:puct:visits") && e.name()=="mcts:500:heavy:rave" );
+    assert( e.parse("mcts:500:ucb1") && e.name()=="mcts:500:heavy:rave:ucb1" );
+    assert( e.parse("mcts:500:proof") && e.mProof>0 && e.name()=="mcts:500:heavy:rave:proof:ucb1" );
+    assert( e.parse("alphabeta:5000") && e.mKind==alphabeta_engine && e.name()=="alphabeta:5000" );
+    assert( e.parse("minimax")==false );
+    assert( e.parse("mcts:100:light")==false );
+    
+    tournament_result r;
+    assert( r.score()==0.5 );
+    r.mWins[0] = 30;
+    r.mWins[1] = 10;
+    assert( r.score()==0.75 );
+    assert( r.confidence()>0.1 && r.confidence()<0.15 );
+    assert( r.elo()>190 && r.elo()<192 );
+    
+    // a search beats random moves, playing either colour
+    tournament_settings settings;
+    settings.mEngines[0].parse("mcts:300");
+    settings.mEngines[1].parse("random");
+    settings.mGames = 8;
+    settings.mThreads = 2;
+    settings.mRandomPlies = 2;
+    settings.mProgress = false;
+    r = run_tournament(settings);
+    assert( r.games()==8 );
+    assert( r.mWins[0] > r.mWins[1] );
+    
+    if (verbose) report(settings, r, stdout);
+}
+
+void engine_tests(bool verbose)
+{
+    opening_book testbook;
+    board b;
+    move::fromstring("A1A+").apply(&b, 0);
+    testbook.add(b, move::fromstring("E5D-"));
+    
+    engine_settings settings;
+    settings.parse("mcts:200");
+    engine_server server(settings);
+    server.mBook = &testbook;
+    
+    istringstream in(
+        "isready\n"
+        "position start moves A1A+\n"
+        "go playouts 5000\n"
+        "info\n"
+        "position start moves A1A+ B2B+\n"
+        "go playouts 100\n"
+        "isready\n"
+        "position start moves A1A+ B2B+\n"
+        "stats\n"
+        "position board XXXXX.|......|......|OOOO..|O.....|......\n"
+        "go\n"
+        "position board OOO...|......|......|......|......|......\n"
+        "position board OOOZ..|XXX...|......|......|......|......\n"
+        "position start moves A1D+ A1B+\n"
+        "position start moves Z9A\n"
+        "go movetime\n"
+        "bogus\n"
+        "position start\n"
+        "go movetime 50\n"
+        "stop\n"
+        "position start moves A1A+ B2B+ C3C+\n"
+        "go clock 2000 increment 100\n"
+        "quit\n"
+        "go\n");
+    ostringstream out;
+    server.run(in, out);
+    
+    vector<string> lines;
+    istringstream answers(out.str());
+    for (string line; getline(answers, line); )
+    {
+        lines.push_back(line);
+        if (verbose) printf("%s\n", line.c_str());
+    }
+    
+    // every request answered, the book used when it can be, and nothing after quit
+    assert( find(lines.begin(), lines.end(), "readyok")!=lines.end() );
+    assert( find(lines.begin(), lines.end(), "error game over")!=lines.end() );
+    assert( find(lines.begin(), lines.end(), "error illegal move: A1B+")!=lines.end() );
+    assert( find(lines.begin(), lines.end(), "error invalid move: Z9A")!=lines.end() );
+    assert( find(lines.begin(), lines.end(), "error expected as many O stones as X, or one more")!=lines.end() );
+    assert( find(lines.begin(), lines.end(), "error expected . O or X")!=lines.end() );
+    assert( find(lines.begin(), lines.end(), "error expected playouts N, movetime MS, clock MS or increment MS")!=lines.end() );
+    assert( find(lines.begin(), lines.end(), "error unknown command: bogus")!=lines.end() );
+    
+    int searches = 0, books = 0;
+    for (size_t i=0;i!=lines.size();++i)
+    {
+        if (lines[i].compare(0, 9, "bestmove ")==0)
+        {
+            assert( valid_move(lines[i].substr(9)) );
+            ++searches;
+        }
+        if (lines[i].compare(0, 16, "info source book")==0) ++books;
+    }
+    assert( searches==4 );
+    assert( books>=1 );
+    
+    // the stats of the 100 playout search, waited for by the position request
+    bool stats = false;
+    for (size_t i=0;i!=lines.size();++i)
+        stats |= lines[i].compare(0, 24, "stats {\"iterations\":100,")==0;
+    assert( stats );
+    
+    // a forced win is played without searching
+    settings.parse("mcts:200:proof");
+    mcts::Arena< pentago::move > arena;
+    int iterations = 0;
+    const char* source;
+    search_limit limit( 0, false, engine_clock::now(), 0, &iterations );
+    const pentago::move m = choose_move( settings, 0, 0, four, 8, arena, limit, &source );
+    assert( string(source)=="proof" && m.mP==four_win && iterations==0 );
+}
+
+void service_tests(bool verbose)
+{
+    // tasks can submit more tasks, and any worker may run them
+    {
+        thread_pool pool(3);
+        std::atomic<int> count(0);
+        for (int i=0;i!=10;++i)
+        {
+            pool.submit( [&]() {
+                assert( thread_pool::worker()>=0 && thread_pool::worker()<3 );
+                for (int j=0;j!=10;++j)
+                    pool.submit( [&]() { ++count; } );
+                ++count;
+            } );
+        }
+        pool.wait();
+        assert( count==110 );
+        assert( thread_pool::worker()==-1 );
+    }
+    
+    engine_settings settings;
+    settings.parse("mcts:200");
+    search_service service(settings, 2);
+    
+    // many games at once, every one answered with a legal move
+    std::mutex lock;
+    vector<move_reply> replies;
+    vector<move_request> requests;
+    mcts::Random rng;
+    for (int id=0;id!=12;++id)
+    {
+        move_request request;
+        request.mId = id;
+        for (int n=0;n!=id;++n)
+        {
+            const pentago::move m = uniform_move(request.mBoard, request.mTurn, rng);
+            m.apply(&request.mBoard, request.mTurn++);
+        }
+        request.mPlayouts = (id%3==0) ? 0 : 100;
+        request.mMilliseconds = (id%3==1) ? 1 : 0;
+        requests.push_back(request);
+        
+        service.submit( request, [&]( const move_reply& reply ) {
+            std::lock_guard< std::mutex > guard(lock);
+            replies.push_back(reply);
+        } );
+    }
+    service.wait();
+    
+    assert( replies.size()==requests.size() );
+    for (size_t i=0;i!=replies.size();++i)
+    {
+        const move_request& request = requests[ replies[i].mId ];
+        assert( request.mBoard.get(replies[i].mMove.mP)==empty );
+        assert( replies[i].mIterations>=1 );
+        if (request.mPlayouts) assert( replies[i].mIterations<=request.mPlayouts );
+        if (request.mId%3==0) assert( replies[i].mIterations==200 );
+    }
+    
+    // through the line protocol
+    istringstream in(
+        "search 7 100 0 start moves A1D+\n"
+        "search 8 0 20 board XXXX..|......|......|OOOO..|......|......\n"
+        "search 9 100 0 start moves A1D+ A1B+\n"
+        "search 10 100\n"
+        "search 11 100 0 board OOO...|......|......|......|......|......\n"
+        "search 12 100 0 board ZZZZZ.|......|......|......|......|......\n"
+        "play 11\n");
+    ostringstream out;
+    service.serve(in, out);
+    if (verbose) printf("%s", out.str().c_str());
+    
+    const string answers = out.str();
+    assert( answers.find("bestmove 7 ")!=string::npos );
+    assert( answers.find("bestmove 8 ")!=string::npos );
+    assert( answers.find("error 9 illegal move: A1B+")!=string::npos );
+    assert( answers.find("error 10 expected ID PLAYOUTS MILLISECONDS")!=string::npos );
+    assert( answers.find("error 11 expected as many O stones as X, or one more")!=string::npos );
+    assert( answers.find("error 12 expected . O or X")!=string::npos );
+    assert( answers.find("error 0 unknown command: play")!=string::npos );
 }
 
 void run_tests(bool verbose)
@@ -1062,6 +2236,18 @@ void run_tests(bool verbose)
         "......\n").symetrical_b() == false
     );   
     
+    evaluate_tests(verbose);
+    tune_tests(verbose);
+    book_tests(verbose);
+    posdb_tests(verbose);
+    tablebase_tests(verbose);
+    proof_tests(verbose);
+    alphabeta_tests(verbose);
+    perft_tests(verbose);
+    gamerecord_tests(verbose);
+    tournament_tests(verbose);
+    engine_tests(verbose);
+    service_tests(verbose);
     mcts_tests(verbose);
 }
 
@@ -1069,6 +2255,26 @@ int main(int argc, char** argv)
 {
     bool verbose = false;
     bool test = false;
+    bool tuning = false;
+    tune_settings tuner;
+    const char * bookpath = 0;
+    book_settings booker;
+    const char * makedb = 0;
+    const char * querydb = 0;
+    const char * tbpath = 0;
+    tablebase_settings tbsettings;
+    bool matches = false;
+    tournament_settings matcher;
+    bool perfting = false;
+    perft_settings perfter;
+    bool serving = false;
+    bool hosting = false;
+    int threads = 0;
+    engine_settings served;
+    
+    // applied again over the command line's search settings, once they're all known
+    const char* served_spec = 0;
+    const char* engine_specs[2] = { 0, 0 };
     
     for (int i=1; i!=argc; ++i)
     {
@@ -1080,14 +2286,193 @@ int main(int argc, char** argv)
             verbose = true;
         else if (strcmp(str,"verbose")==0)
             verbose = true;
-        else if (strcmp(str,"ai1"))
+        else if (strcmp(str,"heavy")==0)
+            rollout = heuristic_rollout;
+        else if (strcmp(str,"expandall")==0)
+            mcts_config.mExpandOne = false;
+        else if (strncmp(str,"expand=",7)==0)
+            mcts_config.mExpandThreshold = atoi(str+7);
+        else if (strncmp(str,"nodes=",6)==0)
+            mcts_config.mNodeBudget = atoi(str+6);
+        else if (strcmp(str,"stats")==0)
+            show_stats = true;
+        else if (strcmp(str,"ponder")==0)
+            ponder = true;
+        else if (strcmp(str,"split")==0)
+            split_turns = served.mSplit = true;
+        else if (strcmp(str,"select=ucb1")==0)
+            mcts_config.mSelection = mcts::SelectUcb1;
+        else if (strcmp(str,"select=tuned")==0)
+            mcts_config.mSelection = mcts::SelectUcb1Tuned;
+        else if (strcmp(str,"select=puct")==0)
+            mcts_config.mSelection = mcts::SelectPuct;
+        else if (strncmp(str,"explore=",8)==0)
+            mcts_config.mExploration = atof(str+8);
+        else if (strcmp(str,"final=visits")==0)
+            mcts_config.mFinal = mcts::FinalVisits;
+        else if (strcmp(str,"final=ratio")==0)
+            mcts_config.mFinal = mcts::FinalRatio;
+        else if (strcmp(str,"final=secure")==0)
+            mcts_config.mFinal = mcts::FinalSecure;
+        else if (strncmp(str,"minvisits=",10)==0)
+            mcts_config.mMinVisits = atoi(str+10);
+        else if (strncmp(str,"clock=",6)==0)
+        {
+            clocked = true;
+            ai_clock[0] = ai_clock[1] = mcts::GameClock( atof(str+6) );
+        }
+        else if (strcmp(str,"alphabeta")==0)
+            use_alphabeta = true;
+        else if (strncmp(str,"proof=",6)==0)
+            proof_nodes = atoi(str+6);
+        else if (strncmp(str,"rave=",5)==0)
+            mcts_config.mRave = atof(str+5);
+        else if (strcmp(str,"norecycle")==0)
+            mcts_config.mRecycle = false;
+        else if (strncmp(str,"cutoff=",7)==0)
+            rollout_cutoff = atoi(str+7);
+        else if (strcmp(str,"tune")==0)
+            tuning = true;
+        else if (strncmp(str,"games=",6)==0)
+            tuner.mGames = matcher.mGames = atoi(str+6);
+        else if (strncmp(str,"playouts=",9)==0)
+            tuner.mPlayouts = booker.mPlayouts = atoi(str+9);
+        else if (strncmp(str,"book=",5)==0)
+        {
+            if (book.load(str+5)==false)
+                cout << "unable to load book: " << str+5 << endl;
+        }
+        else if (strncmp(str,"buildbook=",10)==0)
+            bookpath = str+10;
+        else if (strncmp(str,"makedb=",7)==0)
+            makedb = str+7;
+        else if (strncmp(str,"querydb=",8)==0)
+            querydb = str+8;
+        else if (strncmp(str,"record=",7)==0)
+        {
+            if (game_log.open(str+7)==false)
+                cout << "unable to open game record: " << str+7 << endl;
+        }
+        else if (strncmp(str,"tb=",3)==0)
+        {
+            if (endgame.open(str+3)==false)
+                cout << "unable to load tablebase: " << str+3 << endl;
+        }
+        else if (strncmp(str,"buildtb=",8)==0)
+            tbpath = str+8;
+        else if (strncmp(str,"empties=",8)==0)
+            tbsettings.mEmpties = atoi(str+8);
+        else if (strncmp(str,"seeds=",6)==0)
+            tbsettings.mSeeds = atoi(str+6);
+        else if (strncmp(str,"plies=",6)==0)
+            booker.mPlies = atoi(str+6);
+        else if (strncmp(str,"threads=",8)==0)
+            threads = tuner.mThreads = booker.mThreads = tbsettings.mThreads = matcher.mThreads =
+                perfter.mThreads = atoi(str+8);
+        else if (strncmp(str,"perft=",6)==0)
+        {
+            perfting = true;
+            perfter.mDepth = atoi(str+6);
+        }
+        else if (strncmp(str,"count=",6)==0 && perfter.parse_mode(str+6))
+            perfting = true;
+        else if (strncmp(str,"hash=",5)==0)
+            perfter.mHashBytes = (size_t)atoi(str+5) << 20;
+        else if (strcmp(str,"engine")==0)
+            serving = true;
+        else if (strcmp(str,"service")==0)
+            hosting = true;
+        else if (strncmp(str,"search=",7)==0 && served.parse(str+7))
+            served_spec = str+7;
+        else if (strcmp(str,"tournament")==0)
+            matches = true;
+        else if (strncmp(str,"engine0=",8)==0 && matcher.mEngines[0].parse(str+8))
+            engine_specs[0] = str+8;
+        else if (strncmp(str,"engine1=",8)==0 && matcher.mEngines[1].parse(str+8))
+            engine_specs[1] = str+8;
+        else if (strcmp(str,"ai0")==0)
             autoai[0] = true;
-        else if (strcmp(str,"ai0"))
+        else if (strcmp(str,"ai1")==0)
             autoai[1] = true;
         else
             cout << "ignoring unrecognised argument: " << str << endl;
     }
     
+    // a single search's threads, where the searches aren't already parallel
+    if (threads) alphabeta_threads = threads;
+    
+    // pondering keeps a single mcts tree, so can't search split turns, or stand in for alphabeta
+    if (ponder && (split_turns || use_alphabeta))
+    {
+        cout << "ignoring ponder, which can't be used with " << (use_alphabeta ? "alphabeta" : "split") << endl;
+        ponder = false;
+    }
+    
+    // split turns have no AMAF keys (see splitstate.h)
+    if (split_turns && mcts_config.mRave>0)
+    {
+        cout << "ignoring rave, which can't be used with split" << endl;
+        mcts_config.mRave = 0;
+    }
+    
     if (test) run_tests(verbose);
+    else if (tuning)
+    {
+        tuner.mConfig = mcts_config;
+        tune(tuner, stdout);
+    }
+    else if (serving || hosting)
+    {
+        served.mConfig = mcts_config;
+        served.mCutoff = rollout_cutoff;
+        served.mProof = proof_nodes;
+        if (rollout==heuristic_rollout) served.mRollout = rollout;
+        if (served_spec) served.parse(served_spec);
+        if (serving) served.mThreads = alphabeta_threads;
+        
+        if (hosting)
+        {
+            search_service service(served, threads);
+            service.mBook = book.size() ? &book : 0;
+            service.mTablebase = endgame.size() ? &endgame : 0;
+            service.serve(cin, cout);
+        }
+        else
+        {
+            engine_server server(served);
+            server.mBook = book.size() ? &book : 0;
+            server.mTablebase = endgame.size() ? &endgame : 0;
+            server.run(cin, cout);
+        }
+    }
+    else if (matches)
+    {
+        for (int e=0;e!=2;++e)
+        {
+            matcher.mEngines[e].mConfig = mcts_config;
+            matcher.mEngines[e].mCutoff = rollout_cutoff;
+            matcher.mEngines[e].mProof = proof_nodes;
+            if (engine_specs[e]) matcher.mEngines[e].parse(engine_specs[e]);
+        }
+        matcher.mLog = game_log.is_open() ? &game_log : 0;
+        report(matcher, run_tournament(matcher), stdout);
+    }
+    else if (perfting) report(perfter, perft(board(), 0, perfter), stdout);
+    else if (makedb) make_database(makedb);
+    else if (querydb) query_database(querydb);
+    else if (bookpath)
+    {
+        booker.mConfig = mcts_config;
+        booker.mRollout = rollout;
+        booker.mCutoff = rollout_cutoff;
+        build_book(booker, &book);
+        if (book.save(bookpath)==false)
+            cout << "unable to save book: " << bookpath << endl;
+    }
+    else if (tbpath)
+    {
+        if (build_tablebase(tbsettings, tablebase_seeds(tbsettings), tbpath)==0)
+            cout << "unable to build tablebase: " << tbpath << endl;
+    }
     else interactive();
 }
\ No newline at end of file
@@ -31,6 +31,29 @@
 //      over estimation == over allocation in setting a stack size
 //      under estimation == search will reallocate during a playouts to size the stack
 //    int TurnsLeft() const;
+//
+//    - Rollout policy hook, play the game out to the end from the current state,
+//      drawing any random numbers from rng (see mcts::Random), and return the winner.
+//      Only called when the tree stops growing before the game ends (Config::mExpandOne).
+//    template< typename Rng >
+//    int PlayRollout( Rng& rng );
+//
+//    - Optionally, play and take back a move in place, so the search walks down the tree
+//      without copying the state at each step (detected at compile time, see GamePath).
+//      Undo is always of the last move applied.
+//    void Apply( const Move& move );
+//    void Undo( const Move& move );
+//
+//    - Optionally, for RAVE (Config::mRave), a key per move, and a rollout that records its moves
+//      (detected at compile time, see HasAmaf).
+//    static const int amaf_keys;
+//    static int AmafKey( const Move& move );
+//    template< typename Rng >
+//    int PlayRollout( Rng& rng, std::vector< Move >* played );
+//
+//    - Optionally, for PUCT (Config::mSelection), weights for how likely each move is
+//      to be the best (detected at compile time, see HasPriors).
+//    void GetPriors( const Move* moves, int n, float* priors ) const;
 //        
 // Then call as follows to get a "good" guess of the next move to play, in bounded time:
 //
@@ -56,6 +79,23 @@
 //     
 //         clock_t dt, currentTurnClockStart;
 //     };
+//
+// - Or a TimeManager, which is also given the tree, to stop early when the move is settled,
+//   and think longer when it isn't, with a GameClock to budget the whole game:
+//
+//     double target, maximum;
+//     gameClock.Budget( movesLeft, &target, &maximum );
+//     mcts::TimeManager timeOutFn( target, maximum );
+//
+// Or keep a Tree between moves, to search on through the opponent's turn:
+//
+// mcts::Arena< Move > arena( config.mNodeBudget );
+// mcts::Tree< Move, GameState > tree( gameState, config, arena );
+// tree.Search( timeOutFn );
+// Move ai_move = tree.BestMove();
+// tree.Advance( ai_move );
+// ... tree.Search( untilTheOpponentMovesFn ) on another thread ...
+// tree.Advance( their_move );
 // 
 
 #ifndef MCTS_H_INCLUDED
@@ -64,23 +104,638 @@
 #include <cmath>
 #include <cfloat>
 #include <cassert>
+#include <cstdint>
 
 // TODO: Still want to remove the use of std::vector
 // it's really just me being a bit lazy about allocations
 #include <vector>
+#include <algorithm>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <utility>
+#include <type_traits>
 
 namespace mcts
 {
     const float uct_c = sqrt(2);
     
+    // small xorshift generator, passed to the rollout policy,
+    // each search owns one so playouts don't share the global rand() state
+    class Random
+    {
+        public:
+            Random( uint32_t seed=2463534242u )
+                : mV(seed ? seed : 2463534242u)
+            { }
+        
+            uint32_t operator()()
+            {
+                mV ^= mV << 13;
+                mV ^= mV >> 17;
+                mV ^= mV << 5;
+                return mV;
+            }
+        
+            // returns a value in the range [0,n)
+            int operator()(int n)
+            {
+                return (int)(((uint64_t)(*this)() * (uint64_t)n) >> 32);
+            }
+        
+        private:
+            uint32_t mV;
+    };
+    
+    // how the search chooses which child to try next (see Ucb1, Ucb1Tuned and Puct)
+    enum Selection
+    {
+        SelectUcb1,
+        SelectUcb1Tuned,
+        SelectPuct
+    };
+    
+    // how the move is chosen from the root when the search ends:
+    // the most visited, the best win ratio of those visited at least Config::mMinVisits times,
+    // or the best lower bound on the win ratio (the secure child)
+    enum FinalMove
+    {
+        FinalVisits,
+        FinalRatio,
+        FinalSecure
+    };
+    
+    struct Config
+    {
+        Config()
+            : mExpandOne(true)
+            , mExpandThreshold(1)
+            , mNodeBudget(0)
+            , mRecycle(true)
+            , mRave(0)
+            , mSelection(SelectUcb1)
+            , mExploration(uct_c)
+            , mFinal(FinalVisits)
+            , mMinVisits(1)
+        { }
+        
+        // when true only one node is expanded per iteration,
+        // and the game is finished with the GameState's PlayRollout policy,
+        // so memory grows with iterations rather than iterations x depth,
+        // when false every node visited is expanded, down to the end of the game
+        bool mExpandOne;
+        
+        // with mExpandOne, a leaf is only expanded once it has been visited this many times,
+        // until then playouts start from the leaf itself
+        int mExpandThreshold;
+        
+        // maximum number of nodes the search may hold at once, 0 for no limit,
+        // must be large enough for the root moves
+        size_t mNodeBudget;
+        
+        // when the budget is reached, either recycle the least visited subtrees (true)
+        // or stop expanding and play out from the leaves (false)
+        bool mRecycle;
+        
+        // RAVE equivalence, the visits at which a node's own results and its all-moves-as-first
+        // results are weighted equally, 0 for plain UCT,
+        // only used when the GameState supports it (see HasAmaf)
+        float mRave;
+        
+        Selection mSelection;
+        
+        // the weight of exploration, c in UCB1 and PUCT
+        float mExploration;
+        
+        FinalMove mFinal;
+        int mMinVisits;
+    };
+    
     template< typename NodeType >
     struct PlayoutTurn
     {
-        PlayoutTurn( NodeType* n, int p ) : mNode(n), mPlayer(p) { }
+        PlayoutTurn( NodeType* n, int p, int k=0 ) : mNode(n), mPlayer(p), mKey(k) { }
+        
+        // 0 for the moves of the rollout, which are only kept for RAVE
         NodeType* mNode;
         int mPlayer;
+        
+        // the move's AMAF key, with RAVE
+        int mKey;
+    };
+    
+    // What a search did, filled in by Tree::Search and Tree::GetStats
+    template< typename Move >
+    struct Stats
+    {
+        Stats()
+            : mIterations(0)
+            , mMaxDepth(0)
+            , mSelect(0)
+            , mExpand(0)
+            , mPlayout(0)
+            , mBackprop(0)
+            , mRecycle(0)
+            , mNodes(0)
+            , mPeakNodes(0)
+            , mBytes(0)
+        { }
+        
+        // these accumulate over every Search given the same Stats
+        int mIterations;
+        
+        // deepest tree node reached, in moves from the root
+        int mMaxDepth;
+        
+        // seconds spent in each phase of the iterations
+        double mSelect;
+        double mExpand;
+        double mPlayout;
+        double mBackprop;
+        double mRecycle;
+        
+        // these describe the tree as it is, set by GetStats
+        
+        // in the tree, and the most the arena has held at once
+        size_t mNodes;
+        size_t mPeakNodes;
+        
+        // held by the arena, live and free
+        size_t mBytes;
+        
+        // most visited line from the root
+        std::vector< Move > mPV;
+        
+        struct RootMove
+        {
+            Move mMove;
+            int mVisits;
+            int mWins;
+        };
+        std::vector< RootMove > mRoot;
+        
+        // as a JSON object, with moves written by moveToString( const Move& )
+        template< typename MoveToString >
+        std::string Json( MoveToString moveToString ) const;
+    };
+    
+    template< typename Move >
+    template< typename MoveToString >
+    std::string Stats<Move>::Json( MoveToString moveToString ) const
+    {
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer),
+            "{\"iterations\":%i,\"max_depth\":%i,\"nodes\":%lu,\"peak_nodes\":%lu,\"bytes\":%lu,"
+            "\"seconds\":{\"select\":%.6f,\"expand\":%.6f,\"playout\":%.6f,\"backprop\":%.6f,\"recycle\":%.6f},",
+            mIterations, mMaxDepth, (unsigned long)mNodes, (unsigned long)mPeakNodes, (unsigned long)mBytes,
+            mSelect, mExpand, mPlayout, mBackprop, mRecycle);
+        std::string result = buffer;
+        
+        result += "\"pv\":[";
+        for (size_t i=0;i!=mPV.size();++i)
+        {
+            if (i) result += ",";
+            result += "\"" + std::string( moveToString(mPV[i]) ) + "\"";
+        }
+        
+        result += "],\"root\":[";
+        for (size_t i=0;i!=mRoot.size();++i)
+        {
+            snprintf(buffer, sizeof(buffer), "%s{\"move\":\"%s\",\"visits\":%i,\"win_rate\":%.4f}",
+                i ? "," : "", std::string( moveToString(mRoot[i].mMove) ).c_str(), mRoot[i].mVisits,
+                mRoot[i].mVisits ? (double)mRoot[i].mWins / mRoot[i].mVisits : 0.0);
+            result += buffer;
+        }
+        result += "]}";
+        return result;
+    }
+    
+    // times the phases of a search, when there are stats to fill
+    class PhaseClock
+    {
+        public:
+            typedef std::chrono::steady_clock Clock;
+            
+            PhaseClock( bool on )
+                : mOn(on)
+            {
+                if (mOn) mLast = Clock::now();
+            }
+            
+            // seconds since the last lap, or construction
+            double Lap()
+            {
+                if (!mOn) return 0;
+                const Clock::time_point now = Clock::now();
+                const double result = std::chrono::duration< double >( now - mLast ).count();
+                mLast = now;
+                return result;
+            }
+            
+        private:
+            bool mOn;
+            Clock::time_point mLast;
+    };
+    
+    // one side's clock for a whole game, budgeting each move's search
+    class GameClock
+    {
+        public:
+            GameClock( double seconds=0, double increment=0 )
+                : mRemaining(seconds)
+                , mIncrement(increment)
+            { }
+            
+            // the time to aim for, and never exceed, searching the next move,
+            // with at most movesLeft of the side's moves still to play
+            void Budget( int movesLeft, double* target, double* maximum ) const
+            {
+                const double share = mRemaining / std::max(movesLeft, 1) + mIncrement;
+                *maximum = std::min( 3*share, mRemaining/2 );
+                *target = std::min( share, *maximum );
+            }
+            
+            // after each move, when the increment is added
+            void Spend( double seconds )
+            {
+                mRemaining += mIncrement - seconds;
+            }
+            
+            double Remaining() const
+            {
+                return mRemaining;
+            }
+            
+        private:
+            double mRemaining;
+            double mIncrement;
+    };
+    
+    // timeOut for a Tree search that watches the root:
+    // it stops before the target once the most visited move can't be overtaken
+    // in the time left at the rate the search is going (exact for FinalVisits),
+    // and carries on past the target, up to the maximum, while the two most visited
+    // are close, or the most visited has only just changed
+    class TimeManager
+    {
+        public:
+            typedef std::chrono::steady_clock Clock;
+            
+            // in seconds from now
+            TimeManager( double target, double maximum )
+                : mStart( Clock::now() )
+                , mTarget(target)
+                , mMaximum( std::max(target, maximum) )
+                , mIterations(0)
+                , mLeader(-1)
+                , mChanged(0)
+                , mUnsettled(true)
+                , mStoppedEarly(false)
+            { }
+            
+            // the root is checked every few iterations, the clock every one
+            static const int check_interval = 16;
+            
+            // within this fraction of the leader's visits, the runner up is close
+            static constexpr float close = 0.9f;
+            
+            template< typename TreeType >
+            bool operator()( const TreeType& tree )
+            {
+                const double elapsed = Elapsed();
+                if (elapsed >= mMaximum) return false;
+                if (++mIterations % check_interval)
+                    return elapsed < mTarget || mUnsettled;
+                
+                int most, second;
+                const int leader = tree.MostVisited( &most, &second );
+                if (leader!=mLeader)
+                {
+                    mLeader = leader;
+                    mChanged = elapsed;
+                }
+                mUnsettled = second >= most*close || elapsed - mChanged < mTarget/4;
+                
+                // the visits the runner up could still gain, before the target, or past it the maximum
+                const double limit = (elapsed < mTarget) ? mTarget : mMaximum;
+                const double remaining = mIterations / std::max(elapsed, 1e-6) * (limit - elapsed);
+                if (second + remaining < most)
+                {
+                    mStoppedEarly = elapsed < mTarget;
+                    return false;
+                }
+                return elapsed < mTarget || mUnsettled;
+            }
+            
+            // without the tree, just the target
+            bool operator()()
+            {
+                ++mIterations;
+                return Elapsed() < mTarget;
+            }
+            
+            double Elapsed() const
+            {
+                return std::chrono::duration< double >( Clock::now() - mStart ).count();
+            }
+            
+            int Iterations() const { return mIterations; }
+            bool StoppedEarly() const { return mStoppedEarly; }
+            
+        private:
+            Clock::time_point mStart;
+            double mTarget;
+            double mMaximum;
+            int mIterations;
+            int mLeader;
+            double mChanged;
+            bool mUnsettled;
+            bool mStoppedEarly;
+    };
+    
+    // detects the optional in-place interface of a GameState:
+    //    void Apply( const Move& );
+    //    void Undo( const Move& );   - undoes the last move applied
+    template< typename GameState, typename Move >
+    struct HasApplyUndo
+    {
+        template< typename G >
+        static auto Test( int ) -> decltype( std::declval<G&>().Apply( std::declval<const Move&>() ),
+            std::declval<G&>().Undo( std::declval<const Move&>() ), std::true_type() );
+        
+        template< typename G >
+        static std::false_type Test( ... );
+        
+        static const bool value = decltype( Test<GameState>(0) )::value;
+    };
+    
+    // detects the optional all-moves-as-first interface of a GameState, for RAVE:
+    //    static const int amaf_keys;
+    //    static int AmafKey( const Move& );                       - in [0,amaf_keys)
+    //    int PlayRollout( Rng&, std::vector<Move>* played );    - also recording the moves played
+    // moves with the same key share their AMAF statistics,
+    // and the players are assumed to alternate through the playout
+    template< typename GameState, typename Move >
+    struct HasAmaf
+    {
+        template< typename G >
+        static auto Test( int ) -> decltype( G::AmafKey( std::declval<const Move&>() ),
+            std::declval<G&>().PlayRollout( std::declval<Random&>(), std::declval< std::vector<Move>* >() ),
+            std::true_type() );
+        
+        template< typename G >
+        static std::false_type Test( ... );
+        
+        static const bool value = decltype( Test<GameState>(0) )::value;
+    };
+    
+    template< typename Move, typename GameState, bool Supported = HasAmaf< GameState, Move >::value >
+    struct Amaf
+    {
+        static const int keys = 0;
+        
+        static int Key( const Move& )
+        {
+            return 0;
+        }
+        
+        template< typename Path, typename Rng >
+        static int Rollout( Path& path, Rng& rng, std::vector<Move>* )
+        {
+            return path.Rollout( rng );
+        }
+    };
+    
+    template< typename Move, typename GameState >
+    struct Amaf< Move, GameState, true >
+    {
+        static const int keys = GameState::amaf_keys;
+        
+        static int Key( const Move& move )
+        {
+            return GameState::AmafKey( move );
+        }
+        
+        template< typename Path, typename Rng >
+        static int Rollout( Path& path, Rng& rng, std::vector<Move>* played )
+        {
+            return path.Rollout( rng, played );
+        }
+    };
+    
+    // detects the optional prior probabilities of a GameState's moves, for PUCT:
+    //    void GetPriors( const Move* moves, int n, float* priors ) const;
+    // any non-negative weights, they're normalised, and without them every move is as likely
+    template< typename GameState, typename Move >
+    struct HasPriors
+    {
+        template< typename G >
+        static auto Test( int ) -> decltype( std::declval<const G&>().GetPriors( std::declval<const Move*>(), 0, std::declval<float*>() ),
+            std::true_type() );
+        
+        template< typename G >
+        static std::false_type Test( ... );
+        
+        static const bool value = decltype( Test<GameState>(0) )::value;
+    };
+    
+    template< typename Move, typename GameState, bool Supported = HasPriors< GameState, Move >::value >
+    struct Priors
+    {
+        static void Get( const GameState&, const Move*, int n, float* priors )
+        {
+            std::fill( priors, priors+n, 1.0f );
+        }
+    };
+    
+    template< typename Move, typename GameState >
+    struct Priors< Move, GameState, true >
+    {
+        static void Get( const GameState& theGame, const Move* moves, int n, float* priors )
+        {
+            theGame.GetPriors( moves, n, priors );
+        }
+    };
+    
+    // selection policies, scoring each visited child for SelectNode
+    // from its win ratio (blended with RAVE), its visits, and its prior,
+    // constructed with the total visits of it and its siblings
+    
+    // UCB1, the original UCT
+    struct Ucb1
+    {
+        Ucb1( float c, int trials ) : mC(c), mLogTrials( log((float)trials) ) { }
+        
+        float operator()( float ratio, int sims, float ) const
+        {
+            return ratio + mC * sqrt(mLogTrials / sims);
+        }
+        
+        // every child is tried once before any is tried again
+        float Unvisited( float ) const
+        {
+            return FLT_MAX;
+        }
+        
+        float mC;
+        float mLogTrials;
+    };
+    
+    // UCB1-Tuned (Auer et al.), exploration bounded by the variance of the results,
+    // which for a win ratio is ratio*(1-ratio), so needs nothing more kept, and no c
+    struct Ucb1Tuned
+    {
+        Ucb1Tuned( int trials ) : mLogTrials( log((float)trials) ) { }
+        
+        float operator()( float ratio, int sims, float ) const
+        {
+            const float v = ratio*(1-ratio) + sqrt(2*mLogTrials / sims);
+            return ratio + sqrt(mLogTrials / sims * std::min(0.25f, v));
+        }
+        
+        float Unvisited( float ) const
+        {
+            return FLT_MAX;
+        }
+        
+        float mLogTrials;
+    };
+    
+    // PUCT (as AlphaZero), exploration in proportion to each move's prior (see HasPriors),
+    // so the unlikely moves needn't all be tried once
+    struct Puct
+    {
+        Puct( float c, int trials ) : mC(c), mRootTrials( sqrt((float)std::max(trials, 1)) ) { }
+        
+        float operator()( float ratio, int sims, float prior ) const
+        {
+            return ratio + mC * prior * mRootTrials / (1+sims);
+        }
+        
+        // valued as even until tried
+        float Unvisited( float prior ) const
+        {
+            return (*this)( 0.5f, 0, prior );
+        }
+        
+        float mC;
+        float mRootTrials;
+    };
+    
+    // the game state down one path from the root of the tree,
+    // copied at each step, unless the GameState can apply and undo moves in place
+    template< typename Move, typename GameState, bool InPlace = HasApplyUndo< GameState, Move >::value >
+    class GamePath
+    {
+        public:
+            GamePath( GameState& root )
+                : mRoot(root)
+                , mGame(root)
+            { }
+            
+            // from the root
+            void Begin()
+            {
+                mGame = mRoot;
+            }
+            
+            const GameState& Game() const
+            {
+                return mGame;
+            }
+            
+            void Play( const Move& move )
+            {
+                mGame = mGame.PlayMove( move );
+            }
+            
+            // plays the game out, after which only End may be called
+            template< typename Rng >
+            int Rollout( Rng& rng )
+            {
+                return mGame.PlayRollout( rng );
+            }
+            
+            template< typename Rng, typename Played >
+            int Rollout( Rng& rng, Played* played )
+            {
+                return mGame.PlayRollout( rng, played );
+            }
+            
+            // back to the root
+            void End()
+            { }
+            
+        private:
+            GameState& mRoot;
+            GameState mGame;
+    };
+    
+    template< typename Move, typename GameState >
+    class GamePath< Move, GameState, true >
+    {
+        public:
+            GamePath( GameState& root )
+                : mGame(root)
+            { }
+            
+            void Begin()
+            {
+                assert( mMoves.empty() );
+            }
+            
+            const GameState& Game() const
+            {
+                return mGame;
+            }
+            
+            void Play( const Move& move )
+            {
+                mGame.Apply( move );
+                mMoves.push_back( move );
+            }
+            
+            // the rollout plays on to the end of the game, so gets the one copy
+            template< typename Rng >
+            int Rollout( Rng& rng )
+            {
+                GameState playout( mGame );
+                return playout.PlayRollout( rng );
+            }
+            
+            template< typename Rng, typename Played >
+            int Rollout( Rng& rng, Played* played )
+            {
+                GameState playout( mGame );
+                return playout.PlayRollout( rng, played );
+            }
+            
+            void End()
+            {
+                while (!mMoves.empty())
+                {
+                    mGame.Undo( mMoves.back() );
+                    mMoves.pop_back();
+                }
+            }
+            
+        private:
+            GameState& mGame;
+            std::vector< Move > mMoves;
     };
     
+    template< typename Move >
+    class Arena;
+    
+    template< typename Move, typename GameState >
+    class Tree;
+    
+    template< typename Move >
+    class Node;
+    
+    template< typename Move, typename GameState >
+    Node<Move>* GetAllNodes( const GameState& theGame, int* nodeCount, Arena<Move>& arena, const Config& config );
+    
     template< typename Move >
     class Node
     {
@@ -89,16 +744,24 @@ namespace mcts
                 : mMove(move)
                 , mWins(0)
                 , mSims(0)
+                , mAmafWins(0)
+                , mAmafSims(0)
+                , mPrior(0)
                 , mChildCount(0)
                 , mChildren(0)
             { }
         
-            float UCT(float lnt) const
+            // the win ratio, with rave (Config::mRave) blended with the AMAF ratio,
+            // which is trusted less as the node's own visits grow
+            float Value(float rave=0) const
             {
-                if (mSims==0) return FLT_MAX;
-                float uct = (float)mWins / (float)mSims;
-                uct += uct_c * sqrt(lnt / (float)mSims);
-                return uct;
+                float value = (float)mWins / (float)mSims;
+                if (rave>0 && mAmafSims)
+                {
+                    const float beta = sqrt(rave / (3*mSims + rave));
+                    value += beta * ((float)mAmafWins / (float)mAmafSims - value);
+                }
+                return value;
             }
         
             float Ratio() const
@@ -107,28 +770,166 @@ namespace mcts
             }
 
             static int CountTrials(Node<Move>* nodes, size_t n);
-            static void Cleanup(Node<Move>* nodes, size_t n);
+            static void Cleanup(Node<Move>* nodes, size_t n, Arena<Move>& arena);
             static int CountNodes(Node<Move>* nodes, size_t n);
+            static void Recycle(Node<Move>* nodes, size_t n, Arena<Move>& arena, size_t target);
             
-            static Node<Move>* SelectNode(Node<Move>* nodes, size_t n);
+            // by config's selection policy
+            static Node<Move>* SelectNode(Node<Move>* nodes, size_t n, const Config& config);
+            
+            template< typename Policy >
+            static Node<Move>* SelectNode(Node<Move>* nodes, size_t n, float rave, const Policy& policy);
             
             typedef std::vector< PlayoutTurn< Node<Move> > > PlayoutStack;
             
-            template< typename GameState > 
-            static int Explore( Node< Move >* node, GameState theGame, PlayoutStack& stack );
+            // from node, at the end of path, which is left wherever the playout stopped,
+            // stats, when given, has its phase times and depth updated
+            template< typename GameState, typename Rng > 
+            static int Explore( Node< Move >* node, GamePath< Move, GameState >& path, PlayoutStack& stack, const Config& config, Arena<Move>& arena, Rng& rng, Stats<Move>* stats=0 );
             
             template< typename GameState, typename TimeoutFn > 
             static Move GetMove( GameState theGame, TimeoutFn timeOut );
+            
+            template< typename GameState, typename TimeoutFn > 
+            static Move GetMove( GameState theGame, TimeoutFn timeOut, const Config& config );
+            
+            template< typename GameState, typename TimeoutFn > 
+            static Move GetMove( GameState theGame, TimeoutFn timeOut, const Config& config, Arena<Move>& arena );
+            
+            template< typename GameState, typename TimeoutFn > 
+            static Move GetMove( GameState theGame, TimeoutFn timeOut, const Config& config, Arena<Move>& arena, Stats<Move>* stats );
         
             int ChildCount() const;
         private:
+            friend class Arena<Move>;
+            template< typename M, typename G > friend class Tree;
+            template< typename M, typename G > friend Node<M>* GetAllNodes( const G&, int*, Arena<M>&, const Config& );
+            
             Move mMove;
             int mWins;
             int mSims;
+            
+            // of the playouts through the parent in which the same player
+            // made a move with this one's key, at this point or later
+            int mAmafWins;
+            int mAmafSims;
+            
+            // normalised over its siblings, for PUCT
+            float mPrior;
+            
             int mChildCount;
             Node* mChildren;
     };
     
+    // Allocator for the child arrays of a search,
+    // released arrays are kept on free lists by size for reuse,
+    // and the total held (live or free) is kept within the node budget
+    template< typename Move >
+    class Arena
+    {
+        public:
+            Arena( size_t budget=0 )
+                : mBudget(budget)
+                , mLive(0)
+                , mHeld(0)
+                , mPeak(0)
+                , mRecycled(0)
+                , mPasses(0)
+            { }
+            
+            ~Arena()
+            {
+                assert(mLive==0);
+                Trim(0);
+            }
+            
+            // returns 0 if n more nodes would exceed the budget
+            Node<Move>* Allocate( size_t n )
+            {
+                if (n < mFree.size() && mFree[n])
+                {
+                    Node<Move>* result = mFree[n];
+                    mFree[n] = result->mChildren;
+                    mLive += n;
+                    mPeak = std::max(mPeak, mLive);
+                    return result;
+                }
+                
+                if (mBudget && mHeld+n > mBudget)
+                {
+                    // give back free arrays of other sizes to make room
+                    Trim( mBudget-n );
+                    if (mHeld+n > mBudget)
+                        return 0;
+                }
+                
+                mHeld += n;
+                mLive += n;
+                mPeak = std::max(mPeak, mLive);
+                return new Node<Move>[n];
+            }
+            
+            // the array is threaded onto the free list through its first node
+            void Release( Node<Move>* nodes, size_t n )
+            {
+                if (n >= mFree.size())
+                    mFree.resize(n+1, 0);
+                
+                nodes->mChildren = mFree[n];
+                mFree[n] = nodes;
+                mLive -= n;
+            }
+            
+            // delete free arrays until no more than target nodes are held
+            void Trim( size_t target )
+            {
+                for (size_t n=0; n!=mFree.size() && mHeld>target; ++n)
+                {
+                    while (mFree[n] && mHeld>target)
+                    {
+                        Node<Move>* nodes = mFree[n];
+                        mFree[n] = nodes->mChildren;
+                        delete [] nodes;
+                        mHeld -= n;
+                    }
+                }
+            }
+            
+            // scratch space for generating moves before the array size is known
+            std::vector<Move>& Scratch()
+            {
+                return mScratch;
+            }
+            
+            // and for the moves' priors
+            std::vector<float>& PriorScratch()
+            {
+                return mPriorScratch;
+            }
+            
+            size_t Budget() const { return mBudget; }
+            size_t Live() const { return mLive; }
+            size_t Peak() const { return mPeak; }
+            size_t Held() const { return mHeld; }
+            
+            // number of subtrees, and number of passes, recycled to stay within budget
+            size_t Recycled() const { return mRecycled; }
+            size_t Passes() const { return mPasses; }
+            
+        private:
+            friend class Node<Move>;
+            
+            size_t mBudget;
+            size_t mLive;
+            size_t mHeld;
+            size_t mPeak;
+            size_t mRecycled;
+            size_t mPasses;
+            std::vector< Node<Move>* > mFree;
+            std::vector< Move > mScratch;
+            std::vector< float > mPriorScratch;
+    };
+    
     template< typename Move >    
     int Node<Move>::ChildCount() const
     {
@@ -147,14 +948,14 @@ namespace mcts
     }
     
     template< typename Move >
-    void Node<Move>::Cleanup(Node<Move>* nodes, size_t n)
+    void Node<Move>::Cleanup(Node<Move>* nodes, size_t n, Arena<Move>& arena)
     {
         for (int i=0;i!=n;++i)
         {
             if (nodes[i].mChildren)
-                Cleanup(nodes[i].mChildren, nodes[i].ChildCount());
+                Cleanup(nodes[i].mChildren, nodes[i].ChildCount(), arena);
         }
-        delete nodes;
+        arena.Release(nodes, n);
     }
 
     template< typename Move >
@@ -169,58 +970,193 @@ namespace mcts
         return total;
     }
     
+    template< typename NodeType >
+    struct RecycleCandidate
+    {
+        NodeType* mNode;
+        int mSims;
+        int mDepth;
+        
+        // least visited first, and deepest first between equals,
+        // so descendants always come before their ancestors
+        bool operator<( const RecycleCandidate& rhs ) const
+        {
+            if (mSims!=rhs.mSims) return mSims < rhs.mSims;
+            return mDepth > rhs.mDepth;
+        }
+    };
+    
+    template< typename Move >
+    void Node<Move>::Recycle(Node<Move>* nodes, size_t n, Arena<Move>& arena, size_t target)
+    {
+        typedef RecycleCandidate< Node<Move> > Candidate;
+        std::vector< Candidate > candidates;
+        
+        // every expanded node below the root moves is a candidate
+        std::vector< Candidate > open;
+        for (size_t i=0;i!=n;++i)
+        {
+            Candidate c = { &nodes[i], nodes[i].mSims, 0 };
+            if (nodes[i].mChildren) open.push_back(c);
+        }
+        while (!open.empty())
+        {
+            Candidate c = open.back();
+            open.pop_back();
+            candidates.push_back(c);
+            
+            Node<Move>* children = c.mNode->mChildren;
+            for (int i=0;i!=c.mNode->mChildCount;++i)
+            {
+                Candidate child = { &children[i], children[i].mSims, c.mDepth+1 };
+                if (children[i].mChildren) open.push_back(child);
+            }
+        }
+        
+        // freeing a subtree only frees candidates already visited
+        std::sort( candidates.begin(), candidates.end() );
+        for (size_t i=0; i!=candidates.size() && arena.Live()>target; ++i)
+        {
+            Node<Move>* node = candidates[i].mNode;
+            if (node->mChildren)
+            {
+                Cleanup(node->mChildren, node->mChildCount, arena);
+                node->mChildren = 0;
+                arena.mRecycled++;
+            }
+        }
+        
+        arena.mPasses++;
+    }
+    
     template< typename Move >
-    Node<Move>* Node<Move>::SelectNode(Node<Move>* nodes, size_t n)
+    Node<Move>* Node<Move>::SelectNode(Node<Move>* nodes, size_t n, const Config& config)
     {
-        float best_uct = -FLT_MAX;
+        const int trials = CountTrials(nodes, n);
+        switch (config.mSelection)
+        {
+            case SelectUcb1Tuned:
+                return SelectNode( nodes, n, config.mRave, Ucb1Tuned(trials) );
+            case SelectPuct:
+                return SelectNode( nodes, n, config.mRave, Puct(config.mExploration, trials) );
+            case SelectUcb1:
+                break;
+        }
+        return SelectNode( nodes, n, config.mRave, Ucb1(config.mExploration, trials) );
+    }
+    
+    template< typename Move >
+    template< typename Policy >
+    Node<Move>* Node<Move>::SelectNode(Node<Move>* nodes, size_t n, float rave, const Policy& policy)
+    {
+        float best_score = -FLT_MAX;
         Node<Move>* result = 0;
-        const float lnt = log( (float)CountTrials(nodes, n) );
         for (int i=0; i!=n; ++i)
         {
-            float uct = nodes[i].UCT(lnt);
-            if (uct>best_uct) 
+            const Node<Move>& node = nodes[i];
+            const float score = node.mSims 
+                ? policy( node.Value(rave), node.mSims, node.mPrior ) 
+                : policy.Unvisited( node.mPrior );
+            if (score>best_score) 
             {
                 result = &nodes[i];
-                best_uct = uct;
+                best_score = score;
             }
         }
         
         return result;
     }
     
+    // returns 0 if the arena can't fit the nodes within its budget,
+    // the moves' priors are only looked up when needed, for PUCT
     template< typename Move, typename GameState >
-    Node<Move>* GetAllNodes( GameState theGame, int* nodeCount )
+    Node<Move>* GetAllNodes( const GameState& theGame, int* nodeCount, Arena<Move>& arena, const Config& config )
     {
+        std::vector<Move>& moves = arena.Scratch();
         const int m = theGame.CountPossibleMoves();
-        Node<Move>* result = new Node<Move>[m];
-        Node<Move>* end = theGame.GetPossibleMoves( result );
-        *nodeCount = end-result;
+        moves.resize(m);
+        
+        Move* end = theGame.GetPossibleMoves( &moves[0] );
+        *nodeCount = end-&moves[0];
         assert( *nodeCount<=m );
+        
+        Node<Move>* result = arena.Allocate( *nodeCount );
+        if (result)
+            std::copy( &moves[0], end, result );
+        
+        if (result && config.mSelection==SelectPuct)
+        {
+            std::vector<float>& priors = arena.PriorScratch();
+            priors.resize( *nodeCount );
+            Priors< Move, GameState >::Get( theGame, &moves[0], *nodeCount, &priors[0] );
+            
+            float total = 0;
+            for (int i=0; i!=*nodeCount; ++i)
+                total += priors[i];
+            for (int i=0; i!=*nodeCount; ++i)
+                result[i].mPrior = total>0 ? priors[i]/total : 1.0f / *nodeCount;
+        }
         return result;
     }
     
     template< typename Move >
-    template< typename GameState > 
-    int Node<Move>::Explore( Node< Move >* node, GameState theGame, PlayoutStack& stack )
+    template< typename GameState, typename Rng > 
+    int Node<Move>::Explore( Node< Move >* node, GamePath< Move, GameState >& path, PlayoutStack& stack, const Config& config, Arena<Move>& arena, Rng& rng, Stats<Move>* stats )
     {
+        const GameState& theGame = path.Game();
+        PhaseClock clock( stats!=0 );
         stack.clear();
         
-        do
+        bool expanded = false;
+        while (theGame.Finished()==false)
         {
             if (node->mChildren == 0)
             {
-                node->mChildren = GetAllNodes<Move>( theGame, &node->mChildCount );
+                // tree phase ends at the first new leaf,
+                // or at a leaf that hasn't been visited enough to be worth expanding
+                if (config.mExpandOne && (expanded || node->mSims < config.mExpandThreshold))
+                    break;
+                    
+                if (stats) stats->mSelect += clock.Lap();
+                node->mChildren = GetAllNodes<Move>( theGame, &node->mChildCount, arena, config );
+                if (stats) stats->mExpand += clock.Lap();
+                
+                // out of budget, play out from the leaf instead
+                if (node->mChildren == 0)
+                    break;
+                    
+                expanded = true;
             }
             
-            node = SelectNode(node->mChildren, node->mChildCount);
-            theGame = theGame.PlayMove( node->mMove );
-            
+            // the player making the move, whose wins the node counts
             int p = theGame.GetCurrentPlayer();
-            stack.push_back( PlayoutTurn< Node<Move> >( node, p ) );
             
-        }while(theGame.Finished()==false);
+            node = SelectNode(node->mChildren, node->mChildCount, config);
+            path.Play( node->mMove );
+            
+            stack.push_back( PlayoutTurn< Node<Move> >( node, p, Amaf< Move, GameState >::Key( node->mMove ) ) );
+        }
         
-        const int winner = theGame.GetWinner();
+        if (stats)
+        {
+            stats->mSelect += clock.Lap();
+            stats->mMaxDepth = std::max( stats->mMaxDepth, (int)stack.size()+1 );
+        }
+        
+        // playout phase, only reached when the tree stopped short of the end,
+        // with RAVE the rollout's moves are recorded (in the arena's scratch space, free until the next expansion)
+        const bool amaf = config.mRave>0 && Amaf< Move, GameState >::keys>0;
+        std::vector<Move>& played = arena.Scratch();
+        played.clear();
+        const int player = theGame.GetCurrentPlayer();
+        int winner;
+        if (theGame.Finished())
+            winner = theGame.GetWinner();
+        else if (amaf)
+            winner = Amaf< Move, GameState >::Rollout( path, rng, &played );
+        else
+            winner = path.Rollout( rng );
+        if (stats) stats->mPlayout += clock.Lap();
         
         // back propagate the explored nodes
         for (int i=0; i!=stack.size(); ++i)
@@ -229,6 +1165,14 @@ namespace mcts
             stack[i].mNode->mWins += (winner==stack[i].mPlayer);
         }
         
+        // the rollout's moves follow the tree's on the stack, for Tree to update the AMAF statistics
+        if (amaf)
+        {
+            for (size_t i=0; i!=played.size(); ++i)
+                stack.push_back( PlayoutTurn< Node<Move> >( 0, player ^ (i&1), Amaf< Move, GameState >::Key( played[i] ) ) );
+        }
+        if (stats) stats->mBackprop += clock.Lap();
+        
         return winner;
     }
     
@@ -236,38 +1180,343 @@ namespace mcts
     template< typename GameState, typename TimeoutFn > 
     Move Node<Move>::GetMove( GameState theGame, TimeoutFn timeOut )
     {
-        int moveCount;
-        Node* moveList = GetAllNodes<Move>( theGame, &moveCount );
-        Node* best = moveList;
+        return GetMove( theGame, timeOut, Config() );
+    }
+    
+    template< typename Move >
+    template< typename GameState, typename TimeoutFn > 
+    Move Node<Move>::GetMove( GameState theGame, TimeoutFn timeOut, const Config& config )
+    {
+        Arena<Move> arena( config.mNodeBudget );
+        return GetMove( theGame, timeOut, config, arena );
+    }
+    
+    template< typename Move >
+    template< typename GameState, typename TimeoutFn > 
+    Move Node<Move>::GetMove( GameState theGame, TimeoutFn timeOut, const Config& config, Arena<Move>& arena )
+    {
+        return GetMove( theGame, timeOut, config, arena, 0 );
+    }
+    
+    template< typename Move >
+    template< typename GameState, typename TimeoutFn > 
+    Move Node<Move>::GetMove( GameState theGame, TimeoutFn timeOut, const Config& config, Arena<Move>& arena, Stats<Move>* stats )
+    {
+        Tree< Move, GameState > tree( theGame, config, arena );
+        tree.Search( timeOut, stats );
+        if (stats) tree.GetStats( stats );
+        return tree.BestMove();
+    }
+    
+    // a timeOut is given the tree when it takes one (as TimeManager), otherwise called without
+    template< typename TimeoutFn, typename TreeType >
+    auto CallTimeOut( TimeoutFn& timeOut, const TreeType& tree, int ) -> decltype( timeOut(tree) )
+    {
+        return timeOut(tree);
+    }
+    
+    template< typename TimeoutFn, typename TreeType >
+    bool CallTimeOut( TimeoutFn& timeOut, const TreeType&, long )
+    {
+        return timeOut();
+    }
+    
+    // A search tree kept from one move to the next,
+    // so the search can carry on while the opponent thinks (pondering),
+    // and the subtree of the move actually played is kept rather than searched again.
+    // Advance also needs the GameState to support:
+    //    bool operator==( const GameState& ) const
+    template< typename Move, typename GameState >
+    class Tree
+    {
+        public:
+            typedef Node<Move> NodeType;
+            
+            Tree( const GameState& theGame, const Config& config, Arena<Move>& arena )
+                : mGame(theGame)
+                , mPath(mGame)
+                , mConfig(config)
+                , mArena(arena)
+                , mRoot(0)
+                , mRootCount(0)
+            {
+                Reset(theGame);
+            }
+            
+            ~Tree()
+            {
+                Clear();
+            }
+            
+            // iterates until timeOut returns false, and can be called again to search further,
+            // adding to stats when given (timing the phases costs a little),
+            // timeOut is used in place when it's an lvalue, so it can report on the search
+            template< typename TimeoutFn >
+            void Search( TimeoutFn&& timeOut, Stats<Move>* stats=0 );
+            
+            // the shape of the tree, and its root moves
+            void GetStats( Stats<Move>* stats ) const;
+            
+            // by the config's final move rule
+            Move BestMove() const;
+            
+            // the index of the most visited root move, and its visits, and the runner up's
+            int MostVisited( int* most, int* second ) const;
+            
+            // moves the root on by move, keeping the subtree below it,
+            // returns false if the move hadn't been searched, and the tree starts again
+            bool Advance( const Move& move );
+            
+            // starts again from theGame
+            void Reset( const GameState& theGame );
+            
+            const GameState& Game() const
+            {
+                return mGame;
+            }
+            
+            // iterations below the root
+            int Trials() const
+            {
+                return mRoot ? NodeType::CountTrials(mRoot, mRootCount) : 0;
+            }
+            
+        private:
+            // not copyable
+            Tree( const Tree& );
+            Tree& operator=( const Tree& );
+            
+            void Clear();
+            
+            // credits every move made, to the same player's siblings with the same key,
+            // at each level from the root down to the trial's playout
+            void UpdateAmaf( NodeType* trial, int winner );
+            
+            GameState mGame;
+            GamePath< Move, GameState > mPath;
+            Config mConfig;
+            Arena<Move>& mArena;
+            NodeType* mRoot;
+            int mRootCount;
+            typename NodeType::PlayoutStack mStack;
+            Random mRng;
+            
+            // by player and AMAF key, the moves made from the current level down
+            std::vector<char> mSeen;
+    };
+    
+    template< typename Move, typename GameState >
+    void Tree<Move, GameState>::Clear()
+    {
+        if (mRoot)
+            NodeType::Cleanup( mRoot, mRootCount, mArena );
+        mRoot = 0;
+        mRootCount = 0;
+    }
+    
+    template< typename Move, typename GameState >
+    void Tree<Move, GameState>::Reset( const GameState& theGame )
+    {
+        Clear();
+        mGame = theGame;
+        if (mGame.Finished()) return;
+        
+        mRoot = GetAllNodes<Move>( mGame, &mRootCount, mArena, mConfig );
+        assert( mRoot );
+        mStack.reserve(mGame.TurnsLeft());
+    }
+    
+    template< typename Move, typename GameState >
+    template< typename TimeoutFn >
+    void Tree<Move, GameState>::Search( TimeoutFn&& timeOut, Stats<Move>* stats )
+    {
+        if (mRootCount<=1) return;
         
-        PlayoutStack stack;
-        stack.reserve(theGame.TurnsLeft());
+        // keep room for the largest possible expansion,
+        // and recycle down to 3/4 of the budget when that runs out
+        const size_t largest = mGame.CountPossibleMoves();
+        const size_t budget = mArena.Budget();
+        const size_t target = (budget*3/4 > largest) ? budget*3/4 - largest : 0;
         
-        if (moveCount>1)
+        PhaseClock clock( stats!=0 );
+        do
         {
-            do
+            if (budget && mConfig.mRecycle && mArena.Live()+largest > budget)
+            {
+                if (stats) clock.Lap();
+                NodeType::Recycle(mRoot, mRootCount, mArena, target);
+                if (stats) stats->mRecycle += clock.Lap();
+            }
+            
+            if (stats) clock.Lap();
+            NodeType* trial = NodeType::SelectNode(mRoot, mRootCount, mConfig);
+        
+            mPath.Begin();
+            mPath.Play( trial->mMove );
+            if (stats) stats->mSelect += clock.Lap();
+            const int winner = NodeType::Explore(trial, mPath, mStack, mConfig, mArena, mRng, stats);
+            mPath.End();
+            if (stats) clock.Lap();
+            trial->mSims++;
+            if (winner==mGame.GetCurrentPlayer())
+                trial->mWins++;
+            if (mConfig.mRave>0 && Amaf< Move, GameState >::keys>0)
+                UpdateAmaf( trial, winner );
+            if (stats)
             {
-                Node* trial = SelectNode(moveList, moveCount);
+                stats->mBackprop += clock.Lap();
+                stats->mIterations++;
+            }
             
-                GameState newGame = theGame.PlayMove( trial->mMove );
-                trial->mSims++;
-                if (Explore(trial, newGame, stack)==theGame.GetCurrentPlayer())
+        }while( CallTimeOut( timeOut, *this, 0 ) );
+    }
+    
+    template< typename Move, typename GameState >
+    void Tree<Move, GameState>::UpdateAmaf( NodeType* trial, int winner )
+    {
+        typedef Amaf< Move, GameState > AmafType;
+        const int keys = AmafType::keys;
+        mSeen.assign( 2*keys, 0 );
+        
+        // from the end of the playout up, so each level sees the moves made from it on
+        for (int i=(int)mStack.size()-1; i>=-1; --i)
+        {
+            const int player = (i>=0) ? mStack[i].mPlayer : mGame.GetCurrentPlayer();
+            mSeen[ player*keys + ((i>=0) ? mStack[i].mKey : AmafType::Key( trial->mMove )) ] = 1;
+            if (i>=0 && mStack[i].mNode==0) continue;
+            
+            // the node's siblings, the moves the player could have made instead
+            NodeType* nodes = (i>0) ? mStack[i-1].mNode->mChildren : (i==0) ? trial->mChildren : mRoot;
+            const int n = (i>0) ? mStack[i-1].mNode->mChildCount : (i==0) ? trial->mChildCount : mRootCount;
+            for (int c=0; c!=n; ++c)
+            {
+                if (mSeen[ player*keys + AmafType::Key( nodes[c].mMove ) ])
                 {
-                    trial->mWins++;
-                    if (trial->Ratio() > best->Ratio())
-                        best = trial;
+                    nodes[c].mAmafSims++;
+                    nodes[c].mAmafWins += (winner==player);
                 }
-                
-            }while( timeOut() );
+            }
         }
+    }
+    
+    template< typename Move, typename GameState >
+    void Tree<Move, GameState>::GetStats( Stats<Move>* stats ) const
+    {
+        stats->mNodes = mRoot ? NodeType::CountNodes(mRoot, mRootCount) : 0;
+        stats->mPeakNodes = mArena.Peak();
+        stats->mBytes = mArena.Held() * sizeof(NodeType);
         
-        // printf("%i / %i\n", CountTrials(moveList, moveCount), CountNodes(moveList, moveCount));
-        // printf("%i%% of %i\n", static_cast<int>(best->Ratio()*100), best->mSims);
+        stats->mRoot.clear();
+        for (int i=0; i!=mRootCount; ++i)
+        {
+            typename Stats<Move>::RootMove r = { mRoot[i].mMove, mRoot[i].mSims, mRoot[i].mWins };
+            stats->mRoot.push_back(r);
+        }
         
-        Move result = best->mMove;
-        Cleanup( moveList, moveCount );
+        stats->mPV.clear();
+        const NodeType* nodes = mRoot;
+        int n = mRootCount;
+        while (nodes && n)
+        {
+            const NodeType* most = &nodes[0];
+            for (int i=1; i!=n; ++i)
+            {
+                if (nodes[i].mSims > most->mSims)
+                    most = &nodes[i];
+            }
+            if (most->mSims==0) break;
             
-        return result;
+            stats->mPV.push_back( most->mMove );
+            nodes = most->mChildren;
+            n = most->mChildCount;
+        }
+    }
+    
+    template< typename Move, typename GameState >
+    bool Tree<Move, GameState>::Advance( const Move& move )
+    {
+        const GameState next = mGame.PlayMove( move );
+        
+        // matched by the position reached, moves that differ only
+        // by rotating a symmetrical quadrant lead to the same place
+        NodeType* kept = 0;
+        for (int i=0; i!=mRootCount && kept==0; ++i)
+        {
+            if (mRoot[i].mChildren && mGame.PlayMove( mRoot[i].mMove )==next)
+                kept = &mRoot[i];
+        }
+        
+        if (kept==0)
+        {
+            Reset(next);
+            return false;
+        }
+        
+        NodeType* children = kept->mChildren;
+        const int childCount = kept->mChildCount;
+        kept->mChildren = 0;
+        Clear();
+        
+        mGame = next;
+        mRoot = children;
+        mRootCount = childCount;
+        return true;
+    }
+    
+    template< typename Move, typename GameState >
+    int Tree<Move, GameState>::MostVisited( int* most, int* second ) const
+    {
+        int leader = -1;
+        *most = *second = 0;
+        for (int i=0; i!=mRootCount; ++i)
+        {
+            const int sims = mRoot[i].mSims;
+            if (sims > *most)
+            {
+                *second = *most;
+                *most = sims;
+                leader = i;
+            }
+            else if (sims > *second)
+                *second = sims;
+        }
+        return leader;
+    }
+    
+    template< typename Move, typename GameState >
+    Move Tree<Move, GameState>::BestMove() const
+    {
+        assert( mRoot );
+        
+        // the most visited, between equals the better ratio,
+        // and the fallback when no move qualifies under the other rules
+        const NodeType* most = &mRoot[0];
+        for (int i=1; i!=mRootCount; ++i)
+        {
+            const NodeType& node = mRoot[i];
+            if (node.mSims > most->mSims || (node.mSims==most->mSims && node.mSims && node.Ratio() > most->Ratio()))
+                most = &node;
+        }
+        if (mConfig.mFinal==FinalVisits) return most->mMove;
+        
+        const NodeType* best = 0;
+        float best_score = -FLT_MAX;
+        for (int i=0; i!=mRootCount; ++i)
+        {
+            const NodeType& node = mRoot[i];
+            if (node.mSims==0 || node.mSims < mConfig.mMinVisits) continue;
+            
+            // the secure child's lower bound, ratio - A/sqrt(visits), with A = 1
+            const float score = (mConfig.mFinal==FinalSecure) 
+                ? node.Ratio() - 1.0f / sqrt((float)node.mSims)
+                : node.Ratio();
+            if (score > best_score)
+            {
+                best = &node;
+                best_score = score;
+            }
+        }
+        return best ? best->mMove : most->mMove;
     }
 }
 
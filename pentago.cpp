@@ -273,6 +273,172 @@ namespace pentago
     }    
     
     
+    // Packing works through the array 3 bytes at a time,
+    // 6 positions sharing a y coordinate, and split into two halves of 12 bits,
+    // each half being 3 positions of one quadrant, 3 digits of its base 3 value.
+    struct pack_tables
+    {
+        // 12 bit half row to its base 3 value, 0-26
+        uint8_t mEncode[1<<12];
+        
+        // and back again
+        uint16_t mDecode[27];
+        
+        pack_tables()
+        {
+            memset(mEncode,0,sizeof(mEncode));
+            for (UInt v=0;v!=27;++v)
+            {
+                const UInt bits = (v%3) | ((v/3%3) << 4) | ((v/9) << 8);
+                mEncode[bits] = v;
+                mDecode[v] = bits;
+            }
+        }
+    };
+    
+    static const pack_tables& get_pack_tables()
+    {
+        static const pack_tables tables;
+        return tables;
+    }
+    
+    uint64_t board_18::pack() const
+    {
+        const pack_tables& t = get_pack_tables();
+        
+        // rows 0-2 are quadrants A & C, rows 3-5 are B & D
+        uint64_t q[4] = { 0, 0, 0, 0 };
+        for (UInt y=6; y--; )
+        {
+            const UInt row = mV[3*y] | (mV[3*y+1] << 8) | (mV[3*y+2] << 16);
+            const UInt a = (y>=3) ? 1 : 0;
+            q[a] = q[a]*27 + t.mEncode[row & 0xfff];
+            q[a+2] = q[a+2]*27 + t.mEncode[row >> 12];
+        }
+        
+        return q[0] | (q[1] << 15) | (q[2] << 30) | (q[3] << 45);
+    }
+    
+    board_18 board_18::unpack( uint64_t v )
+    {
+        const pack_tables& t = get_pack_tables();
+        
+        board_18 result;
+        for (UInt y=0; y!=6; ++y)
+        {
+            const UInt a = (y>=3) ? 1 : 0;
+            const UInt digit = y%3;
+            static const UInt scale[3] = { 1, 27, 729 };
+            
+            const UInt lo = (v >> (15*a)) & 0x7fff;
+            const UInt hi = (v >> (15*(a+2))) & 0x7fff;
+            const UInt row = t.mDecode[lo/scale[digit]%27] | (t.mDecode[hi/scale[digit]%27] << 12);
+            
+            result.mV[3*y] = row & 0xff;
+            result.mV[3*y+1] = (row >> 8) & 0xff;
+            result.mV[3*y+2] = row >> 16;
+        }
+        return result;
+    }
+    
+    const uint8_t lines[line_count][line_length] = {
+        // rows, as winningrow
+        {  0,  6, 12, 18, 24 },
+        {  6, 12, 18, 24, 30 },
+        {  1,  7, 13, 19, 25 },
+        {  7, 13, 19, 25, 31 },
+        {  2,  8, 14, 20, 26 },
+        {  8, 14, 20, 26, 32 },
+        {  3,  9, 15, 21, 27 },
+        {  9, 15, 21, 27, 33 },
+        {  4, 10, 16, 22, 28 },
+        { 10, 16, 22, 28, 34 },
+        {  5, 11, 17, 23, 29 },
+        { 11, 17, 23, 29, 35 },
+        // columns, as winningcol
+        {  0,  1,  2,  3,  4 },
+        {  1,  2,  3,  4,  5 },
+        {  6,  7,  8,  9, 10 },
+        {  7,  8,  9, 10, 11 },
+        { 12, 13, 14, 15, 16 },
+        { 13, 14, 15, 16, 17 },
+        { 18, 19, 20, 21, 22 },
+        { 19, 20, 21, 22, 23 },
+        { 24, 25, 26, 27, 28 },
+        { 25, 26, 27, 28, 29 },
+        { 30, 31, 32, 33, 34 },
+        { 31, 32, 33, 34, 35 },
+        // diagonals, as winningdiag
+        {  0,  7, 14, 21, 28 },
+        {  6, 13, 20, 27, 34 },
+        {  1,  8, 15, 22, 29 },
+        {  7, 14, 21, 28, 35 },
+        { 24, 19, 14,  9,  4 },
+        { 30, 25, 20, 15, 10 },
+        { 25, 20, 15, 10,  5 },
+        { 31, 26, 21, 16, 11 },
+    };
+    
+    const uint8_t position_line_count[6*6] = {
+        3, 4, 3, 3, 4, 3,
+        4, 6, 5, 5, 6, 4,
+        3, 5, 7, 7, 5, 3,
+        3, 5, 7, 7, 5, 3,
+        4, 6, 5, 5, 6, 4,
+        3, 4, 3, 3, 4, 3,
+    };
+    
+    // padded with 0 beyond position_line_count
+    const uint8_t position_lines[6*6][max_lines_per_position] = {
+        {  0, 12, 24,  0,  0,  0,  0 },
+        {  2, 12, 13, 26,  0,  0,  0 },
+        {  4, 12, 13,  0,  0,  0,  0 },
+        {  6, 12, 13,  0,  0,  0,  0 },
+        {  8, 12, 13, 28,  0,  0,  0 },
+        { 10, 13, 30,  0,  0,  0,  0 },
+        {  0,  1, 14, 25,  0,  0,  0 },
+        {  2,  3, 14, 15, 24, 27,  0 },
+        {  4,  5, 14, 15, 26,  0,  0 },
+        {  6,  7, 14, 15, 28,  0,  0 },
+        {  8,  9, 14, 15, 29, 30,  0 },
+        { 10, 11, 15, 31,  0,  0,  0 },
+        {  0,  1, 16,  0,  0,  0,  0 },
+        {  2,  3, 16, 17, 25,  0,  0 },
+        {  4,  5, 16, 17, 24, 27, 28 },
+        {  6,  7, 16, 17, 26, 29, 30 },
+        {  8,  9, 16, 17, 31,  0,  0 },
+        { 10, 11, 17,  0,  0,  0,  0 },
+        {  0,  1, 18,  0,  0,  0,  0 },
+        {  2,  3, 18, 19, 28,  0,  0 },
+        {  4,  5, 18, 19, 25, 29, 30 },
+        {  6,  7, 18, 19, 24, 27, 31 },
+        {  8,  9, 18, 19, 26,  0,  0 },
+        { 10, 11, 19,  0,  0,  0,  0 },
+        {  0,  1, 20, 28,  0,  0,  0 },
+        {  2,  3, 20, 21, 29, 30,  0 },
+        {  4,  5, 20, 21, 31,  0,  0 },
+        {  6,  7, 20, 21, 25,  0,  0 },
+        {  8,  9, 20, 21, 24, 27,  0 },
+        { 10, 11, 21, 26,  0,  0,  0 },
+        {  1, 22, 29,  0,  0,  0,  0 },
+        {  3, 22, 23, 31,  0,  0,  0 },
+        {  5, 22, 23,  0,  0,  0,  0 },
+        {  7, 22, 23,  0,  0,  0,  0 },
+        {  9, 22, 23, 25,  0,  0,  0 },
+        { 11, 23, 27,  0,  0,  0,  0 },
+    };
+    
+    const uint8_t quadrant_lines[4][lines_per_quadrant] = {
+        // A
+        {  0,  1,  2,  3,  4,  5, 12, 13, 14, 15, 16, 17, 24, 25, 26, 27, 28 },
+        // B
+        {  0,  1,  2,  3,  4,  5, 18, 19, 20, 21, 22, 23, 25, 28, 29, 30, 31 },
+        // C
+        {  6,  7,  8,  9, 10, 11, 12, 13, 14, 15, 16, 17, 26, 28, 29, 30, 31 },
+        // D
+        {  6,  7,  8,  9, 10, 11, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 31 },
+    };
+    
     state board_18::winningrow(UInt x)const
     {
         // [012345]
@@ -357,6 +523,31 @@ namespace pentago
         }
         return (state)(rc | rr | winningdiag());
     }
+    
+    static state winning_lines(const board_18& b, const uint8_t* ls, UInt count)
+    {
+        // both players can win at the same time
+        state result = empty;
+        for (UInt i=0;i!=count;++i)
+        {
+            const uint8_t* l = lines[ls[i]];
+            const state r = b.get(position(l[0]));
+            if (r!=empty && r==b.get(position(l[1])) && r==b.get(position(l[2])) &&
+                r==b.get(position(l[3])) && r==b.get(position(l[4])))
+                result = (state)(result | r);
+        }
+        return result;
+    }
+    
+    state board_18::winning_through(const position & p)const
+    {
+        return winning_lines(*this, position_lines[p.get()], position_line_count[p.get()]);
+    }
+    
+    state board_18::winning_across(UInt quadrant)const
+    {
+        return winning_lines(*this, quadrant_lines[quadrant], lines_per_quadrant);
+    }
             
     char tochar( state s )
     {
@@ -444,16 +635,27 @@ namespace pentago
         return result;    
     }
     
-    void move::apply(board_18* board, UInt turn) const
+    bool move::apply(board_18* board, UInt turn, state* winner) const
     {
+        // a new line can only pass through the placed position,
+        // and after the rotation, only cross the rotated quadrant
         board->set( mP, turntostate(turn) );
-        if (board->winning()==empty)
-            mR.apply( board );
+        const state placed = board->winning_through( mP );
+        if (placed!=empty)
+        {
+            if (winner) *winner = placed;
+            return false;
+        }
+        
+        mR.apply( board );
+        if (winner) *winner = board->winning_across( mR.get_quadrant() );
+        return true;
     }
     
-    void move::undo(board_18* board) const
+    void move::undo(board_18* board, bool rotated) const
     {
-        mR.invert().apply( board );
+        if (rotated)
+            mR.invert().apply( board );
         board->clear( mP );
     }
     
@@ -470,6 +672,29 @@ namespace pentago
         return result;
     }
     
+    bool valid_move( const std::string& rhs )
+    {
+        // valid moves are always 3 or 4 characters
+        if (rhs.length()<3) return false;
+        if (rhs.length()>4) return false;
+        
+        // Position [A-F][1-6]
+        if (toupper(rhs[0])>'F') return false;
+        if (toupper(rhs[0])<'A') return false;
+        if (rhs[1]>'6') return false;
+        if (rhs[1]<'1') return false;
+        
+        // Quadrant A,B,C, or D
+        if (toupper(rhs[2])>'D') return false;
+        if (toupper(rhs[2])<'A') return false;
+
+        // Direction (optional) + or -
+        if (rhs.length()==4 && (rhs[3]!='+' && rhs[3]!='-'))
+            return false;
+        
+        return true;
+    }
+    
     std::string tostring( const move& b )
     {
         std::string result;
@@ -482,6 +707,70 @@ namespace pentago
         return result;
     }
     
+    UInt inverse_symmetry( UInt symmetry )
+    {
+        // quarter turns undo each other, everything else undoes itself
+        static const UInt lut[symmetry_count] = { 0, 3, 2, 1, 4, 5, 6, 7 };
+        return lut[symmetry];
+    }
+    
+    position transform( position p, UInt symmetry )
+    {
+        const UInt x = p.getx();
+        const UInt y = p.gety();
+        switch (symmetry)
+        {
+            default:
+            case 0: return position( x, y );
+            case 1: return position( y, 5-x );
+            case 2: return position( 5-x, 5-y );
+            case 3: return position( 5-y, x );
+            case 4: return position( y, x );
+            case 5: return position( 5-x, y );
+            case 6: return position( 5-y, 5-x );
+            case 7: return position( x, 5-y );
+        }
+    }
+    
+    board_18 transform( const board_18& b, UInt symmetry )
+    {
+        board_18 result;
+        for (UInt i=0;i!=6*6;++i)
+        {
+            position p(i);
+            result.set( transform(p, symmetry), b.get(p) );
+        }
+        return result;
+    }
+    
+    move transform( const move& m, UInt symmetry )
+    {
+        // the quadrant is wherever its centre ends up,
+        // and reflections reverse the direction of spin
+        static const position centre[4] = { B2, B5, E2, E5 };
+        position c = transform( centre[m.mR.get_quadrant()], symmetry );
+        UInt q = (c.gety()>=3 ? 1 : 0) | (c.getx()>=3 ? 2 : 0);
+        UInt d = m.mR.get_direction() ^ (symmetry>=4 ? rotation::anticlockwise : 0);
+        
+        return move( transform(m.mP, symmetry), rotation( q | d ) );
+    }
+    
+    uint64_t canonical( const board_18& b, UInt* symmetry )
+    {
+        uint64_t best = pack(b);
+        *symmetry = 0;
+        for (UInt s=1;s!=symmetry_count;++s)
+        {
+            uint64_t key = pack( transform(b, s) );
+            if (key < best)
+            {
+                best = key;
+                *symmetry = s;
+            }
+        }
+        return best;
+    }
+    
     void empty_positions::next()
     {
         do
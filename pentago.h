@@ -30,13 +30,19 @@ namespace pentago
     {
         public:
             position() : mV(0) {}
-            position(const position& rhs) : mV(rhs.mV) {}
             position(UInt x, UInt y)
                 : mV(calc(x,y))
             {
                 
             }
             
+            // from a packed index, as returned by get()
+            explicit position(UInt index)
+                : mV(index)
+            {
+                
+            }
+            
             UInt getx() const 
             {
                 return mV%width;
@@ -67,7 +73,7 @@ namespace pentago
                 set(getx(), y);
             }
         
-            bool operator==(const position& rhs)
+            bool operator==(const position& rhs) const
             {
                 return rhs.mV==mV;
             }
@@ -160,6 +166,11 @@ namespace pentago
                 position p(x,y);
                 set(p, s);
             }
+            
+            bool operator==(const board_18& rhs) const
+            {
+                return memcmp(mV,rhs.mV,18)==0;
+            }
         
             // quadrant rotations, affecting :
             //   aaabbb
@@ -195,8 +206,19 @@ namespace pentago
             state winningcol(UInt index)const;
             state winningdiag()const;
             state winning()const;
+            
+            // the same, but only testing the lines through a position, or crossing a quadrant,
+            // enough after a move when the board before it had no winner
+            state winning_through(const position & p)const;
+            state winning_across(UInt quadrant)const;
         
             static board_18 fromstring( const char* str );
+            
+            // compact 60 bit encoding, for keys and storage,
+            // one 15 bit field per quadrant, holding its 9 positions in base 3
+            // (3^9 < 2^15), in the order A, B, C, D from the low bits
+            uint64_t pack() const;
+            static board_18 unpack( uint64_t v );
         
         private:
             void transpose(const position & offset);
@@ -211,6 +233,22 @@ namespace pentago
     };
     
     typedef board_18 board;
+    
+    // the 32 lines of 5 on which the game can be won:
+    // 12 along each axis and 8 diagonals,
+    // stored as packed position indices (see position::get)
+    const UInt line_count = 32;
+    const UInt line_length = 5;
+    extern const uint8_t lines[line_count][line_length];
+    
+    // the lines through each position, and crossing each quadrant,
+    // for updates that only need to look at the lines a move affects
+    const UInt max_lines_per_position = 7;
+    extern const uint8_t position_line_count[6*6];
+    extern const uint8_t position_lines[6*6][max_lines_per_position];
+    
+    const UInt lines_per_quadrant = 17;
+    extern const uint8_t quadrant_lines[4][lines_per_quadrant];
 
     std::string tostring( const board& b );
     std::string tostring_fancy( const board& b );
@@ -241,6 +279,16 @@ namespace pentago
             rotation( quadrant q, direction d )
                 : mV(q | d)
             { }
+            
+            // from the packed byte, as returned by get()
+            explicit rotation( UInt index )
+                : mV(index)
+            { }
+            
+            UInt get() const
+            {
+                return mV;
+            }
         
             quadrant get_quadrant() const 
             {
@@ -310,16 +358,69 @@ namespace pentago
         // default ctor required for vector.resize(0) to compile
         move() : mP(0,0), mR() { }
         
-        void apply(board_18* board, UInt turn) const;
-        void undo(board_18* board) const;
+        // the rotation is skipped when the placement ends the game,
+        // returns whether it was applied,
+        // only the lines the move touches are tested, so the board mustn't already be won,
+        // when winner is set it's given the board's winning() state after the move
+        bool apply(board_18* board, UInt turn, state* winner=0) const;
+        
+        // rotated, as returned by apply
+        void undo(board_18* board, bool rotated=true) const;
         
         position mP;
         rotation mR;
         
         static move fromstring( const char* str );
+        
+        // 16 bit encoding, 6 bits of position, then 3 bits of rotation
+        uint16_t pack() const
+        {
+            return mP.get() | (mR.get() << 6);
+        }
+        
+        static move unpack( uint16_t v )
+        {
+            return move( position(v & 63), rotation(v >> 6) );
+        }
     };
     
     std::string tostring( const move& b );
+    
+    // the move string format read by move::fromstring, eg. "A1B+" or "A1B"
+    bool valid_move( const std::string& str );
+    
+    // the 8 symmetries of the board, 4 rotations then 4 reflections,
+    // each maps quadrants to quadrants and lines to lines,
+    // so positions related by them have the same value
+    const UInt symmetry_count = 8;
+    UInt inverse_symmetry( UInt symmetry );
+    position transform( position p, UInt symmetry );
+    board_18 transform( const board_18& b, UInt symmetry );
+    move transform( const move& m, UInt symmetry );
+    
+    // see board_18::pack
+    inline uint64_t pack( const board_18& b )
+    {
+        return b.pack();
+    }
+    
+    inline board_18 unpack( uint64_t v )
+    {
+        return board_18::unpack(v);
+    }
+    
+    // the bits of a packed key spread across the whole word, for indexing hash tables,
+    // as the last quadrant only reaches the top bits of the key
+    inline uint64_t hash_key( uint64_t key )
+    {
+        key ^= key >> 31;
+        key *= 0x9E3779B97F4A7C15ull;
+        return key ^ (key >> 32);
+    }
+    
+    // the least packed key over the symmetries of b,
+    // and the symmetry that gives it
+    uint64_t canonical( const board_18& b, UInt* symmetry );
 
     // move_generator
     
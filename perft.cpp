@@ -0,0 +1,221 @@
+// perft.cpp
+
+#include "perft.h"
+#include "gamestate.h"
+#include "locklesstable.h"
+
+#include <cstring>
+
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+namespace pentago
+{
+    // counts below a position are keyed by it and the depth counted,
+    // which has to fit in the 4 bits above the 60 bit key
+    static const int max_hashed_depth = 15;
+
+    bool perft_settings::parse_mode( const char* str )
+    {
+        if (strcmp(str,"moves")==0) mMode = perft_moves;
+        else if (strcmp(str,"positions")==0) mMode = perft_positions;
+        else if (strcmp(str,"symmetric")==0) mMode = perft_symmetric;
+        else return false;
+        return true;
+    }
+
+    const char* perft_settings::mode_name() const
+    {
+        switch (mMode)
+        {
+            case perft_positions: return "positions";
+            case perft_symmetric: return "symmetric";
+            default: return "moves";
+        }
+    }
+
+    namespace
+    {
+        // counts move sequences depth first, with the optional table of counts
+        class sequence_counter
+        {
+            public:
+                explicit sequence_counter( size_t bytes )
+                    : mTable(bytes)
+                    , mHashed(bytes!=0)
+                { }
+
+                // thread safe, nodes is the caller's own
+                uint64_t count( const board& b, int turn, int depth, uint64_t* nodes )
+                {
+                    if (depth==0) return 1;
+
+                    move moves[max_moves];
+                    const int n = (int)(all_moves(b, turn, moves) - moves);
+                    *nodes += n;
+
+                    // the last ply's moves needn't be made to be counted
+                    if (depth==1) return n;
+
+                    // no key is 0, as the depth is at least 2
+                    const bool hashed = mHashed && depth<=max_hashed_depth;
+                    const uint64_t key = hashed ? pack(b) | ((uint64_t)depth << 60) : 0;
+                    uint64_t total = 0;
+
+                    // the moves of this position were counted as nodes, not those below it
+                    if (hashed && mTable.probe(key, &total))
+                        return total;
+
+                    for (int m=0;m!=n;++m)
+                    {
+                        board after = b;
+                        state winner = empty;
+                        moves[m].apply(&after, turn, &winner);
+                        if (winner==empty)
+                            total += count(after, turn+1, depth-1, nodes);
+                    }
+
+                    if (hashed) mTable.store( key, total );
+                    return total;
+                }
+
+            private:
+                lockless_table mTable;
+                bool mHashed;
+        };
+    }
+
+    // every sequence, the root's moves split across the threads
+    static void perft_moves_count( const board& b, int turn, const perft_settings& settings, int threads,
+        perft_result* result )
+    {
+        sequence_counter counter( settings.mHashBytes );
+        if (settings.mDepth<2)
+        {
+            result->mLeaves = counter.count(b, turn, settings.mDepth, &result->mNodes);
+            return;
+        }
+
+        move moves[max_moves];
+        const int n = (int)(all_moves(b, turn, moves) - moves);
+        result->mNodes = n;
+
+        std::mutex lock;
+        std::atomic< int > next(0);
+        std::vector< std::thread > workers;
+        for (int t=0;t!=threads;++t)
+        {
+            workers.push_back( std::thread( [&]() {
+                uint64_t leaves = 0, nodes = 0;
+                for (int i=next++; i<n; i=next++)
+                {
+                    board after = b;
+                    state winner = empty;
+                    moves[i].apply(&after, turn, &winner);
+                    if (winner==empty)
+                        leaves += counter.count(after, turn+1, settings.mDepth-1, &nodes);
+                }
+
+                std::lock_guard< std::mutex > guard(lock);
+                result->mLeaves += leaves;
+                result->mNodes += nodes;
+            } ) );
+        }
+        for (size_t t=0;t!=workers.size();++t)
+            workers[t].join();
+    }
+
+    // the distinct positions of each ply in turn, each ply's positions split across the threads
+    static void perft_positions_count( const board& b, int turn, const perft_settings& settings, int threads,
+        perft_result* result )
+    {
+        const bool symmetric = settings.mMode==perft_symmetric;
+        UInt root_symmetry;
+        std::vector< uint64_t > layer( 1, symmetric ? canonical(b, &root_symmetry) : pack(b) );
+
+        for (int ply=0; ply!=settings.mDepth; ++ply)
+        {
+            std::vector< uint64_t > next;
+            std::mutex lock;
+            std::atomic< size_t > index(0);
+            std::vector< std::thread > workers;
+            for (int t=0;t!=threads;++t)
+            {
+                workers.push_back( std::thread( [&]() {
+                    std::vector< uint64_t > children;
+                    uint64_t nodes = 0;
+                    size_t limit = 1 << 20;
+                    UInt symmetry;
+                    move moves[max_moves];
+                    for (size_t i=index++; i<layer.size(); i=index++)
+                    {
+                        // finished games go no further, a full board has no moves anyway
+                        const board p = unpack(layer[i]);
+                        if (p.winning()!=empty) continue;
+
+                        const int n = (int)(all_moves(p, turn+ply, moves) - moves);
+                        nodes += n;
+                        for (int m=0;m!=n;++m)
+                        {
+                            board after = p;
+                            moves[m].apply(&after, turn+ply);
+                            children.push_back( symmetric ? canonical(after, &symmetry) : pack(after) );
+                        }
+
+                        // duplicates are mostly among siblings, so are dropped before they pile up
+                        if (children.size()>limit)
+                        {
+                            std::sort(children.begin(), children.end());
+                            children.erase(std::unique(children.begin(), children.end()), children.end());
+                            limit = std::max( limit, 2*children.size() );
+                        }
+                    }
+
+                    std::lock_guard< std::mutex > guard(lock);
+                    next.insert(next.end(), children.begin(), children.end());
+                    result->mNodes += nodes;
+                } ) );
+            }
+            for (size_t t=0;t!=workers.size();++t)
+                workers[t].join();
+
+            std::sort(next.begin(), next.end());
+            next.erase(std::unique(next.begin(), next.end()), next.end());
+            layer.swap(next);
+        }
+        result->mLeaves = layer.size();
+    }
+
+    perft_result perft( const board& b, int turn, const perft_settings& settings )
+    {
+        int threads = settings.mThreads;
+        if (threads<=0) threads = std::max( 1u, std::thread::hardware_concurrency() );
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        // a finished game has nothing below it
+        perft_result result;
+        if (settings.mDepth>0 && b.winning()!=empty)
+            result.mLeaves = 0;
+        else if (settings.mMode==perft_moves)
+            perft_moves_count(b, turn, settings, threads, &result);
+        else
+            perft_positions_count(b, turn, settings, threads, &result);
+
+        result.mSeconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+        return result;
+    }
+
+    void report( const perft_settings& settings, const perft_result& result, FILE* out )
+    {
+        fprintf(out, "perft %i %s%s: %llu\n", settings.mDepth, settings.mode_name(),
+            (settings.mMode==perft_moves && settings.mHashBytes) ? " hashed" : "",
+            (unsigned long long)result.mLeaves);
+        fprintf(out, "%llu nodes, %.2f seconds, %.0f nodes/sec\n",
+            (unsigned long long)result.mNodes, result.mSeconds, result.nodes_per_second());
+    }
+}
@@ -0,0 +1,88 @@
+// perft.h
+//
+// Move generation counts, the positions reachable from a position in a number of plies,
+// to check all_moves and move::apply against known totals, and to time them.
+//
+// Counts are of positions at exactly that depth, finished games end their line early
+// and so count towards no deeper total. They're of one of:
+// every sequence of moves, as all_moves generates them
+// (so without the rotations of symmetrical quadrants it leaves out),
+// the distinct positions those sequences reach, or those distinct under the board's symmetries.
+//
+// Sequences are counted depth first, split across threads by the root's moves,
+// optionally remembering the count below each position in a lockless table,
+// so a position reached again by transposition is searched once,
+// its sequences still counted every time it's reached.
+// Distinct positions are counted a ply at a time, the whole of each ply held in memory,
+// so are practical only for the first few plies.
+
+#ifndef PERFT_H_INCLUDED
+#define PERFT_H_INCLUDED
+
+#include "pentago.h"
+
+#include <cstdint>
+#include <cstdio>
+
+namespace pentago
+{
+    enum perft_mode
+    {
+        perft_moves,
+        perft_positions,
+        perft_symmetric
+    };
+
+    struct perft_settings
+    {
+        perft_settings()
+            : mDepth(1)
+            , mMode(perft_moves)
+            , mThreads(0)
+            , mHashBytes(0)
+        { }
+
+        // plies from the position counted
+        int mDepth;
+
+        perft_mode mMode;
+
+        // 0 for one per hardware thread
+        int mThreads;
+
+        // perft_moves only, the size of the table of counts, 0 for none
+        size_t mHashBytes;
+
+        // from "moves", "positions" or "symmetric"
+        bool parse_mode( const char* str );
+        const char* mode_name() const;
+    };
+
+    struct perft_result
+    {
+        perft_result()
+            : mLeaves(0)
+            , mNodes(0)
+            , mSeconds(0)
+        { }
+
+        // the count, positions at the depth
+        uint64_t mLeaves;
+
+        // every move applied, at any depth, to reach them
+        uint64_t mNodes;
+
+        double mSeconds;
+
+        double nodes_per_second() const
+        {
+            return mSeconds>0 ? mNodes/mSeconds : 0.0;
+        }
+    };
+
+    perft_result perft( const board& b, int turn, const perft_settings& settings );
+
+    void report( const perft_settings& settings, const perft_result& result, FILE* out );
+}
+
+#endif
@@ -0,0 +1,95 @@
+// posdb.cpp
+
+#include "posdb.h"
+
+// memory mapping
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pentago
+{
+    struct table_header
+    {
+        char mMagic[4];
+        uint32_t mRecordSize;
+        uint64_t mCount;
+    };
+
+    const void* map_table( const char* path, const char* magic, size_t recordSize,
+        uint64_t* count, void** map, size_t* mapSize )
+    {
+        int fd = open(path, O_RDONLY);
+        if (fd<0) return 0;
+
+        struct stat st;
+        if (fstat(fd, &st)!=0 || (size_t)st.st_size < sizeof(table_header))
+        {
+            close(fd);
+            return 0;
+        }
+
+        void* m = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (m==MAP_FAILED) return 0;
+
+        const table_header* header = (const table_header*)m;
+        if (memcmp(header->mMagic, magic, 4)!=0 ||
+            header->mRecordSize!=recordSize ||
+            sizeof(table_header) + header->mCount*recordSize != (size_t)st.st_size)
+        {
+            munmap(m, st.st_size);
+            return 0;
+        }
+
+        *count = header->mCount;
+        *map = m;
+        *mapSize = st.st_size;
+        return header+1;
+    }
+
+    void unmap_table( void* map, size_t mapSize )
+    {
+        munmap(map, mapSize);
+    }
+
+    bool write_table( const char* path, const char* magic, size_t recordSize,
+        const void* records, uint64_t count )
+    {
+        FILE* f = fopen(path, "wb");
+        if (!f) return false;
+
+        table_header header;
+        memcpy(header.mMagic, magic, 4);
+        header.mRecordSize = recordSize;
+        header.mCount = count;
+
+        bool ok = fwrite(&header, sizeof(header), 1, f)==1;
+        if (ok && count)
+            ok = fwrite(records, recordSize, count, f)==count;
+
+        return (fclose(f)==0) && ok;
+    }
+
+    void position_record::Merge( const position_record& r )
+    {
+        const uint64_t visits = (uint64_t)mVisits + r.mVisits;
+        if (visits)
+            mValue = (int16_t)(((int64_t)mValue*mVisits + (int64_t)r.mValue*r.mVisits) / (int64_t)visits);
+        if (r.mVisits >= mVisits)
+            mMove = r.mMove;
+        mVisits = (uint32_t)std::min( visits, (uint64_t)UINT32_MAX );
+    }
+
+    void position_database_builder::add( const board& b, const move& m, uint32_t visits, int16_t value )
+    {
+        UInt symmetry;
+        position_record r;
+        r.mKey = canonical(b, &symmetry);
+        r.mVisits = visits;
+        r.mValue = value;
+        r.mMove = transform(m, symmetry).pack();
+        add(r);
+    }
+}
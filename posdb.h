@@ -0,0 +1,238 @@
+// posdb.h
+//
+// Read-only position tables, sorted fixed size records
+// keyed by canonical packed board (see canonical in pentago.h).
+//
+// The file is memory mapped rather than loaded, so opening is immediate,
+// and any number of processes share the one copy of its pages.
+// Records are stored in Eytzinger (breadth first binary tree) order,
+// so lookups are a branch-free descent with good cache behaviour.
+//
+// File format, native (little) endian:
+//    4 byte magic, uint32 record size, uint64 record count,
+//    then the records in Eytzinger order.
+//
+// A Record type supports:
+//    uint64_t Key() const;
+//    static const char* Magic();          - 4 characters identifying the table type
+//    void Merge( const Record& other );   - combine another record for the same key
+//    bool operator<( const Record& ) const - ordered by key
+
+#ifndef POSDB_H_INCLUDED
+#define POSDB_H_INCLUDED
+
+#include "pentago.h"
+
+#include <cstdio>
+
+#include <vector>
+#include <algorithm>
+
+namespace pentago
+{
+    // maps the whole of a table file, checking its header,
+    // returns the first record and sets count, or 0 on failure
+    const void* map_table( const char* path, const char* magic, size_t recordSize,
+        uint64_t* count, void** map, size_t* mapSize );
+    void unmap_table( void* map, size_t mapSize );
+
+    // writes the header and records
+    bool write_table( const char* path, const char* magic, size_t recordSize,
+        const void* records, uint64_t count );
+
+    template< typename Record >
+    class mapped_table
+    {
+        public:
+            mapped_table()
+                : mMap(0)
+                , mMapSize(0)
+                , mRecords(0)
+                , mCount(0)
+            { }
+
+            ~mapped_table()
+            {
+                close();
+            }
+
+            bool open( const char* path )
+            {
+                close();
+                mRecords = (const Record*)map_table( path, Record::Magic(), sizeof(Record),
+                    &mCount, &mMap, &mMapSize );
+                return mRecords!=0;
+            }
+
+            void close()
+            {
+                if (mMap) unmap_table(mMap, mMapSize);
+                mMap = 0;
+                mMapSize = 0;
+                mRecords = 0;
+                mCount = 0;
+            }
+
+            // 0 if the key isn't in the table
+            const Record* find( uint64_t key ) const
+            {
+                // descend the implicit tree, 1 based, children of k at 2k and 2k+1,
+                // the comparison result picks the branch instead of a jump
+                uint64_t k = 1;
+                while (k <= mCount)
+                {
+                    __builtin_prefetch( mRecords + 16*k - 1 );
+                    k = 2*k + (mRecords[k-1].Key() < key);
+                }
+
+                // undo the right turns taken after the last left,
+                // which was at the smallest key not less than the one searched for
+                k >>= __builtin_ffsll(~k);
+
+                if (k==0 || mRecords[k-1].Key()!=key) return 0;
+                return &mRecords[k-1];
+            }
+
+            // canonicalises b, and returns the symmetry used to do so
+            const Record* find( const board& b, UInt* symmetry ) const
+            {
+                return find( canonical(b, symmetry) );
+            }
+
+            uint64_t size() const
+            {
+                return mCount;
+            }
+
+            // all the records, in Eytzinger order
+            const Record* records() const
+            {
+                return mRecords;
+            }
+
+        private:
+            // owns the mapping, not copyable
+            mapped_table( const mapped_table& );
+            mapped_table& operator=( const mapped_table& );
+
+            void* mMap;
+            size_t mMapSize;
+            const Record* mRecords;
+            uint64_t mCount;
+    };
+
+    template< typename Record >
+    class table_builder
+    {
+        public:
+            // records with the same key are merged
+            void add( const Record& r )
+            {
+                mRecords.push_back(r);
+            }
+
+            bool write( const char* path )
+            {
+                merge();
+
+                std::vector< Record > layout( mRecords.size() );
+                eytzinger(0, 1, &layout);
+
+                return write_table( path, Record::Magic(), sizeof(Record),
+                    layout.empty() ? 0 : &layout[0], layout.size() );
+            }
+
+            size_t size()
+            {
+                merge();
+                return mRecords.size();
+            }
+
+            // sorted and merged
+            const std::vector< Record >& records()
+            {
+                merge();
+                return mRecords;
+            }
+
+        private:
+            void merge()
+            {
+                std::stable_sort( mRecords.begin(), mRecords.end() );
+
+                size_t out = 0;
+                for (size_t i=0;i!=mRecords.size();++i)
+                {
+                    if (out==0 || mRecords[out-1].Key()!=mRecords[i].Key())
+                        mRecords[out++] = mRecords[i];
+                    else
+                        mRecords[out-1].Merge( mRecords[i] );
+                }
+                mRecords.resize(out);
+            }
+
+            // in order traversal of the implicit tree, taking the sorted records in turn
+            size_t eytzinger( size_t i, uint64_t k, std::vector< Record >* out ) const
+            {
+                if (k <= mRecords.size())
+                {
+                    i = eytzinger(i, 2*k, out);
+                    (*out)[k-1] = mRecords[i++];
+                    i = eytzinger(i, 2*k+1, out);
+                }
+                return i;
+            }
+
+            std::vector< Record > mRecords;
+    };
+
+    // general purpose position record, for books and analysis
+    struct position_record
+    {
+        // canonical packed board
+        uint64_t mKey;
+
+        // searches or games the value is drawn from
+        uint32_t mVisits;
+
+        // for the side to move, meaning depends on the table,
+        // eg. win ratio in 1/10000ths
+        int16_t mValue;
+
+        // best move (see move::pack) on the canonical board, or no_move
+        uint16_t mMove;
+
+        static const uint16_t no_move = 0xffff;
+
+        uint64_t Key() const
+        {
+            return mKey;
+        }
+
+        static const char* Magic()
+        {
+            return "PDB1";
+        }
+
+        // visits summed, values weighted by visits, and the move of the larger kept
+        void Merge( const position_record& r );
+
+        bool operator<( const position_record& rhs ) const
+        {
+            return mKey < rhs.mKey;
+        }
+    };
+
+    typedef mapped_table< position_record > position_database;
+
+    class position_database_builder : public table_builder< position_record >
+    {
+        public:
+            using table_builder< position_record >::add;
+
+            // for the position b, in any orientation
+            void add( const board& b, const move& m, uint32_t visits, int16_t value );
+    };
+}
+
+#endif
@@ -0,0 +1,274 @@
+// proof.cpp
+
+#include "proof.h"
+#include "gamestate.h"
+
+#include <algorithm>
+
+namespace pentago
+{
+    // proven, or disproven, and the cap on sums of numbers
+    static const uint32_t infinity = 0x3fffffff;
+
+    // the attacker is part of the key, the side to move follows from the stones on the board,
+    // and the top bit is set so no key is 0, which marks an unused entry
+    static uint64_t position_key( const board& b, int attacker )
+    {
+        return pack(b) | ((uint64_t)attacker << 60) | (1ull << 63);
+    }
+
+    static uint32_t saturate( uint64_t n )
+    {
+        return n<infinity ? (uint32_t)n : infinity;
+    }
+
+    struct proof_search::child
+    {
+        move mMove;
+
+        // for the success of the child's side to move, known for a finished game,
+        // otherwise from the table when expanded, then as each search of the child leaves them,
+        // so the search goes on even when the table has lost them
+        bool mFinished;
+        uint32_t mPhi;
+        uint32_t mDelta;
+        uint32_t mWork;
+    };
+
+    proof_search::proof_search( size_t bytes )
+        : mGeneration(0)
+        , mNodes(0)
+        , mBudget(0)
+        , mTimed(false)
+        , mAborted(false)
+    {
+        // a power of two, indexed by buckets of two
+        size_t entries = 2;
+        while (entries*2*sizeof(entry) <= bytes)
+            entries *= 2;
+        mTable.resize( entries );
+        clear();
+    }
+
+    size_t proof_search::table_bytes( uint64_t nodes )
+    {
+        return 2 * std::max( nodes, (uint64_t)1 ) * sizeof(entry);
+    }
+
+    void proof_search::clear()
+    {
+        const entry none = { 0, 0, 0, 0, 0 };
+        std::fill( mTable.begin(), mTable.end(), none );
+    }
+
+    // the first of the key's pair of entries
+    size_t proof_search::bucket( uint64_t key ) const
+    {
+        return (size_t)hash_key(key) & (mTable.size()-2);
+    }
+
+    const proof_search::entry* proof_search::lookup( uint64_t key ) const
+    {
+        const size_t i = bucket(key);
+        if (mTable[i].mKey==key) return &mTable[i];
+        if (mTable[i+1].mKey==key) return &mTable[i+1];
+        return 0;
+    }
+
+    void proof_search::store( uint64_t key, uint32_t phi, uint32_t delta, uint64_t work )
+    {
+        // the entry already held, otherwise one left by an earlier solve,
+        // otherwise the one with less work below it, the cheaper to redo
+        const size_t i = bucket(key);
+        entry* e = &mTable[i];
+        const entry& other = mTable[i+1];
+        if (e->mKey!=key && (other.mKey==key || (other.mGeneration!=e->mGeneration
+            ? other.mGeneration!=mGeneration : other.mWork < e->mWork)))
+            e = &mTable[i+1];
+
+        e->mKey = key;
+        e->mPhi = phi;
+        e->mDelta = delta;
+        e->mWork = saturate(work);
+        e->mGeneration = mGeneration;
+    }
+
+    int proof_search::expand( const board& b, int turn, int attacker, child* children ) const
+    {
+        move moves[max_moves];
+        const int n = (int)(all_moves(b, turn, moves) - moves);
+        const bool attacking = (turn&1)==attacker;
+
+        for (int i=0;i!=n;++i)
+        {
+            child& c = children[i];
+            board after = b;
+            state winner = empty;
+            moves[i].apply(&after, turn, &winner);
+
+            c.mMove = moves[i];
+            c.mWork = 0;
+            c.mFinished = winner!=empty || turn+1==6*6;
+            if (c.mFinished)
+            {
+                // a win for the player moving here, or a draw when they're defending, is their success,
+                // so the failure of the child's side to move
+                const bool succeeds = winner==turntostate(turn) || (attacking==false && winner!=turntostate(turn+1));
+                c.mPhi = succeeds ? infinity : 0;
+                c.mDelta = succeeds ? 0 : infinity;
+                continue;
+            }
+
+            // unknown positions start as a single expansion either way
+            const entry* e = lookup( position_key(after, attacker) );
+            c.mPhi = e ? e->mPhi : 1;
+            c.mDelta = e ? e->mDelta : 1;
+            if (e) c.mWork = e->mWork;
+        }
+        return n;
+    }
+
+    bool proof_search::exhausted()
+    {
+        if (mAborted) return true;
+        if (mBudget && mNodes>=mBudget) mAborted = true;
+        if (mTimed && (mNodes & 255)==0 && clock::now()>=mDeadline) mAborted = true;
+        return mAborted;
+    }
+
+    void proof_search::mid( const board& b, int turn, int attacker, uint32_t thphi, uint32_t thdelta,
+        uint32_t* phi, uint32_t* delta )
+    {
+        const uint64_t start = mNodes++;
+
+        child children[max_moves];
+        const int n = expand(b, turn, attacker, children);
+
+        for (;;)
+        {
+            // phi is the least delta of the children, any child failing is our success,
+            // delta the sum of their phis, every child must succeed for us to fail
+            int best = 0;
+            uint32_t second = infinity;
+            uint32_t bestphi = 0;
+            uint64_t sum = 0;
+            *phi = infinity;
+            for (int i=0;i!=n;++i)
+            {
+                const child& c = children[i];
+                if (c.mDelta < *phi)
+                {
+                    second = *phi;
+                    *phi = c.mDelta;
+                    best = i;
+                    bestphi = c.mPhi;
+                }
+                else if (c.mDelta < second)
+                    second = c.mDelta;
+                sum += c.mPhi;
+            }
+            *delta = saturate(sum);
+
+            if (*phi>=thphi || *delta>=thdelta || exhausted())
+                break;
+
+            // the best child is searched until it's no longer best (with a little slack, the 1+e trick,
+            // so the search doesn't thrash between close siblings), or until our delta reaches its threshold
+            const uint32_t cthphi = saturate( (uint64_t)thdelta - *delta + bestphi );
+            const uint32_t cthdelta = std::min( thphi, saturate( (uint64_t)second + second/4 + 1 ) );
+
+            child& c = children[best];
+            board after = b;
+            c.mMove.apply(&after, turn);
+            const uint64_t before = mNodes;
+            mid(after, turn+1, attacker, cthphi, cthdelta, &c.mPhi, &c.mDelta);
+            c.mWork = saturate( c.mWork + (mNodes-before) );
+        }
+
+        store( position_key(b, attacker), *phi, *delta, mNodes-start );
+    }
+
+    void proof_search::prove( const board& b, int turn, int attacker, uint32_t* phi, uint32_t* delta )
+    {
+        const entry* e = lookup( position_key(b, attacker) );
+        if (e && e->proven())
+        {
+            *phi = e->mPhi;
+            *delta = e->mDelta;
+            return;
+        }
+        mid(b, turn, attacker, infinity, infinity, phi, delta);
+    }
+
+    void proof_search::line( board b, int turn, int attacker, std::vector< move >* moves ) const
+    {
+        child children[max_moves];
+        for (;;)
+        {
+            const entry* e = lookup( position_key(b, attacker) );
+            if (e==0 || e->proven()==false) return;
+
+            // succeeding, a move to a failed child, soonest finished,
+            // failing, the move with the most work below it, to resist the longest
+            const int n = expand(b, turn, attacker, children);
+            int chosen = -1;
+            uint32_t most = 0;
+            for (int i=0;i!=n;++i)
+            {
+                const child& c = children[i];
+                if (e->mPhi==0)
+                {
+                    if (c.mDelta!=0) continue;
+                    if (c.mFinished) { chosen = i; break; }
+                    if (chosen<0 || c.mWork<most) { chosen = i; most = c.mWork; }
+                }
+                else if (chosen<0 || children[chosen].mFinished || (c.mFinished==false && c.mWork>most))
+                {
+                    chosen = i;
+                    most = c.mWork;
+                }
+            }
+            if (chosen<0) return;
+
+            moves->push_back( children[chosen].mMove );
+            if (children[chosen].mFinished) return;
+            children[chosen].mMove.apply(&b, turn++);
+        }
+    }
+
+    tablebase_result proof_search::solve( const board& b, int turn, uint64_t nodes, double seconds,
+        std::vector< move >* moves )
+    {
+        ++mGeneration;
+        mNodes = 0;
+        mBudget = nodes;
+        mTimed = seconds>0;
+        mDeadline = clock::now() + std::chrono::duration_cast< clock::duration >( std::chrono::duration< double >(seconds) );
+        mAborted = false;
+        if (moves) moves->clear();
+
+        // first whether the side to move wins, then, if not, whether it loses
+        const int us = turn&1;
+        uint32_t phi, delta;
+        prove(b, turn, us, &phi, &delta);
+        if (phi==0)
+        {
+            if (moves) line(b, turn, us, moves);
+            return tb_win;
+        }
+        if (delta!=0) return tb_unknown;
+
+        prove(b, turn, us^1, &phi, &delta);
+        if (moves) line(b, turn, us^1, moves);
+        return (delta==0) ? tb_loss : (phi==0) ? tb_draw : tb_unknown;
+    }
+
+    bool proven_win( const board& b, int turn, uint64_t nodes, move* m )
+    {
+        proof_search search( proof_search::table_bytes(nodes) );
+        std::vector< move > moves;
+        if (search.solve(b, turn, nodes, 0, &moves)!=tb_win || moves.empty()) return false;
+        *m = moves[0];
+        return true;
+    }
+}
@@ -0,0 +1,103 @@
+// proof.h
+//
+// Depth first proof-number search (df-pn), proving whether the side to move
+// can force a win, and if not whether the opponent can, so leaving a draw.
+//
+// Each proof is an AND/OR search for one attacker: at the attacker's turns one move must win,
+// at the defender's every move must. Proof and disproof numbers, the least number of
+// positions still to be solved to prove or disprove the attacker's win, guide it to the
+// most promising line, and are kept in a fixed size transposition table, so a search that
+// runs out of memory degrades by forgetting the least worked positions rather than failing.
+
+#ifndef PROOF_H_INCLUDED
+#define PROOF_H_INCLUDED
+
+#include "pentago.h"
+#include "tablebase.h"
+
+#include <cstdint>
+#include <vector>
+#include <chrono>
+
+namespace pentago
+{
+    class proof_search
+    {
+        public:
+            // the table holds as many positions as fit in bytes (at least two)
+            explicit proof_search( size_t bytes );
+
+            // bytes for a table that holds every position a search of nodes expansions can store
+            static size_t table_bytes( uint64_t nodes );
+
+            // the result for the side to move of b, which mustn't be finished,
+            // within nodes expansions and seconds (0 for no limit on either),
+            // tb_unknown when the budget runs out first,
+            // line is given the moves of the proof, as far as the table still holds them,
+            // the winner's moves best, the loser's the longest resistance found
+            tablebase_result solve( const board& b, int turn, uint64_t nodes=0, double seconds=0,
+                std::vector< move >* line=0 );
+
+            // positions expanded by the last solve
+            uint64_t nodes() const
+            {
+                return mNodes;
+            }
+
+            // forgets every position
+            void clear();
+
+        private:
+            typedef std::chrono::steady_clock clock;
+
+            // the proof and disproof numbers of a position,
+            // for the success of its side to move, whichever player is attacking
+            struct entry
+            {
+                uint64_t mKey;
+                uint32_t mPhi;
+                uint32_t mDelta;
+                uint32_t mWork;
+
+                // the solve that stored it, earlier solves' entries are replaced first
+                uint32_t mGeneration;
+
+                bool proven() const
+                {
+                    return mPhi==0 || mDelta==0;
+                }
+            };
+
+            struct child;
+
+            // the root's proof and disproof numbers, for attacker
+            void prove( const board& b, int turn, int attacker, uint32_t* phi, uint32_t* delta );
+
+            // multiple iterative deepening, searching below b until either number reaches its threshold
+            void mid( const board& b, int turn, int attacker, uint32_t thphi, uint32_t thdelta,
+                uint32_t* phi, uint32_t* delta );
+
+            int expand( const board& b, int turn, int attacker, child* children ) const;
+            bool exhausted();
+
+            void line( board b, int turn, int attacker, std::vector< move >* moves ) const;
+
+            size_t bucket( uint64_t key ) const;
+            const entry* lookup( uint64_t key ) const;
+            void store( uint64_t key, uint32_t phi, uint32_t delta, uint64_t work );
+
+            std::vector< entry > mTable;
+
+            uint32_t mGeneration;
+            uint64_t mNodes;
+            uint64_t mBudget;
+            bool mTimed;
+            clock::time_point mDeadline;
+            bool mAborted;
+    };
+
+    // the first move of a forced win for the side to move, when one is proven within nodes expansions
+    bool proven_win( const board& b, int turn, uint64_t nodes, move* m );
+}
+
+#endif
@@ -0,0 +1,103 @@
+// service.cpp
+
+#include "service.h"
+
+#include <cstdio>
+
+#include <sstream>
+#include <string>
+
+namespace pentago
+{
+    search_service::search_service( const engine_settings& engine, int threads )
+        : mBook(0)
+        , mTablebase(0)
+        , mEngine(engine)
+        , mPool(threads)
+    {
+        for (int t=0;t!=mPool.size();++t)
+            mArenas.push_back( new mcts::Arena< pentago::move >( engine.mConfig.mNodeBudget ) );
+    }
+
+    search_service::~search_service()
+    {
+        mPool.wait();
+        for (size_t t=0;t!=mArenas.size();++t)
+            delete mArenas[t];
+    }
+
+    void search_service::submit( const move_request& request, const reply_fn& done )
+    {
+        const engine_clock::time_point start = engine_clock::now();
+
+        mPool.submit( [this, request, done, start]() {
+            int playouts = request.mPlayouts;
+            if (playouts==0 && request.mMilliseconds==0)
+                playouts = mEngine.mPlayouts;
+
+            // the deadline runs from the request, so time spent queued counts against it,
+            // a request that has already expired gets a single iteration
+            move_reply reply;
+            reply.mId = request.mId;
+            reply.mIterations = 0;
+            search_limit limit( playouts, request.mMilliseconds>0,
+                start + std::chrono::milliseconds(request.mMilliseconds), 0, &reply.mIterations );
+            reply.mMove = choose_move( mEngine, mBook, mTablebase, request.mBoard, request.mTurn,
+                *mArenas[ thread_pool::worker() ], limit, &reply.mSource );
+            reply.mMilliseconds = std::chrono::duration< double, std::milli >( engine_clock::now() - start ).count();
+
+            done(reply);
+        } );
+    }
+
+    void search_service::wait()
+    {
+        mPool.wait();
+    }
+
+    void search_service::serve( std::istream& in, std::ostream& out )
+    {
+        std::mutex lock;
+
+        std::string line;
+        while (std::getline(in, line))
+        {
+            std::istringstream args(line);
+            std::string command;
+            if (!(args >> command)) continue;
+
+            move_request request;
+            std::string error;
+            if (command!="search")
+                error = "unknown command: " + command;
+            else if (!(args >> request.mId >> request.mPlayouts >> request.mMilliseconds) ||
+                request.mPlayouts<0 || request.mMilliseconds<0)
+                error = "expected ID PLAYOUTS MILLISECONDS";
+            else if (parse_position(args, &request.mBoard, &request.mTurn, &error))
+            {
+                if (request.mBoard.winning()!=empty || request.mTurn==6*6)
+                    error = "game over";
+            }
+
+            if (error.empty()==false)
+            {
+                std::lock_guard< std::mutex > guard(lock);
+                out << "error " << request.mId << " " << error << std::endl;
+                continue;
+            }
+
+            submit( request, [&out, &lock]( const move_reply& reply ) {
+                char info[128];
+                snprintf(info, sizeof(info), "info %i source %s iterations %i time %.0f",
+                    reply.mId, reply.mSource, reply.mIterations, reply.mMilliseconds);
+
+                std::lock_guard< std::mutex > guard(lock);
+                out << info << std::endl;
+                out << "bestmove " << reply.mId << " " << tostring(reply.mMove) << std::endl;
+            } );
+        }
+
+        // the replies refer to out and lock
+        wait();
+    }
+}
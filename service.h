@@ -0,0 +1,99 @@
+// service.h
+//
+// In process move service for many simultaneous games,
+// every game's searches scheduled onto one shared thread pool,
+// with an arena per worker, and the book and tablebase shared read-only.
+//
+// serve() is a line based stand-in for a socket, for testing and local use:
+//    search ID PLAYOUTS MILLISECONDS start|board <rows> [moves ...]
+//        (see parse_position in engine.h, 0 for either budget to leave it unlimited)
+// answered, in whichever order the searches finish, with
+//    info ID source S iterations N time MS
+//    bestmove ID A1B+
+// or "error ID <reason>".
+
+#ifndef SERVICE_H_INCLUDED
+#define SERVICE_H_INCLUDED
+
+#include "pentago.h"
+#include "mcts.h"
+#include "engine.h"
+#include "threadpool.h"
+
+#include <iostream>
+#include <functional>
+#include <vector>
+#include <mutex>
+
+namespace pentago
+{
+    struct move_request
+    {
+        move_request()
+            : mId(0)
+            , mTurn(0)
+            , mPlayouts(0)
+            , mMilliseconds(0)
+        { }
+
+        // chosen by the caller, returned with the reply
+        int mId;
+
+        board mBoard;
+        int mTurn;
+
+        // iteration budget, and deadline from when the request is made, 0 for no limit,
+        // with neither set the service's engine budget is used
+        int mPlayouts;
+        int mMilliseconds;
+    };
+
+    struct move_reply
+    {
+        int mId;
+        pentago::move mMove;
+
+        // "book", "tablebase", "proof" or "search"
+        const char* mSource;
+        int mIterations;
+
+        // from the request to the reply, including time queued
+        double mMilliseconds;
+    };
+
+    class search_service
+    {
+        public:
+            typedef std::function< void( const move_reply& ) > reply_fn;
+
+            // 0 threads for one per hardware thread
+            search_service( const engine_settings& engine, int threads=0 );
+            ~search_service();
+
+            // consulted before searching, when set
+            const opening_book* mBook;
+            const tablebase* mTablebase;
+
+            // done is called on a pool thread as soon as the move is chosen
+            void submit( const move_request& request, const reply_fn& done );
+
+            // until every request has been answered
+            void wait();
+
+            // answers requests from in until the end of the input
+            void serve( std::istream& in, std::ostream& out );
+
+        private:
+            // not copyable
+            search_service( const search_service& );
+            search_service& operator=( const search_service& );
+
+            engine_settings mEngine;
+
+            // one per worker, only ever used by that worker
+            std::vector< mcts::Arena< pentago::move >* > mArenas;
+            thread_pool mPool;
+    };
+}
+
+#endif
@@ -0,0 +1,156 @@
+// splitstate.h
+//
+// mcts adaptor playing each turn as two moves, a placement then a rotation,
+// so the tree has at most 36 then 8 children per level rather than 288,
+// and a placement's statistics are shared by all of its rotations.
+// Placements are moves with the default rotation,
+// rotations carry the position just placed, so every move reads as the whole turn so far.
+// It has no AMAF keys, so RAVE (mcts::Config::mRave) doesn't apply to split trees.
+
+#ifndef SPLITSTATE_H_INCLUDED
+#define SPLITSTATE_H_INCLUDED
+
+#include "pentago.h"
+#include "gamestate.h"
+#include "mcts.h"
+
+namespace pentago
+{
+    struct SplitGameState
+    {
+        // the board, turn, and rollout settings, as between whole turns
+        GameState mGame;
+
+        // a stone has been placed, and the turn finishes with a rotation
+        bool mRotating;
+        position mPlaced;
+
+        SplitGameState(const GameState& game) : mGame(game), mRotating(false), mPlaced(0,0) {}
+        SplitGameState() : mRotating(false), mPlaced(0,0) {}
+
+        bool operator==( const SplitGameState& rhs ) const { return mRotating==rhs.mRotating && mGame==rhs.mGame; }
+
+        // both halves of a turn are the same player's
+        int GetCurrentPlayer() const { return mGame.GetCurrentPlayer(); }
+        int GetWinner() const { return mGame.GetWinner(); }
+
+        // the last placement still rotates, unless it won
+        bool Finished() const { return mGame.Finished(); }
+
+        int TurnsLeft() const { return 2*mGame.TurnsLeft(); }
+
+        int CountPossibleMoves() const
+        {
+            return mRotating ? 8 : mGame.TurnsLeft();
+        }
+
+        template< typename OutItr >
+        OutItr GetPossibleMoves(OutItr itr) const
+        {
+            if (mRotating)
+            {
+                // filter out anti-clockwise rotations of symmetrical quadrants, as all_moves
+                for (rotation r; r.valid(); r.next())
+                {
+                    if (r.get_direction()==rotation::clockwise || r.symetrical(&mGame.mBoard)==false)
+                        *itr++ = pentago::move( mPlaced, r );
+                }
+                return itr;
+            }
+
+            for (empty_positions p(mGame.mBoard); p.finished()==false; p.next())
+                *itr++ = pentago::move( p.get(), rotation() );
+            return itr;
+        }
+
+        // placements as GameState, every rotation as likely
+        void GetPriors( const pentago::move* moves, int n, float* priors ) const
+        {
+            if (mRotating)
+                std::fill( priors, priors+n, 1.0f );
+            else
+                mGame.GetPriors( moves, n, priors );
+        }
+
+        SplitGameState PlayMove( const pentago::move& move ) const
+        {
+            SplitGameState result(*this);
+            result.Apply(move);
+            return result;
+        }
+
+        // the same incremental win detection as move::apply
+        void Apply( const pentago::move& move )
+        {
+            board& b = mGame.mBoard;
+            if (mRotating)
+            {
+                move.mR.apply( &b );
+                mGame.mWinning = b.winning_across( move.mR.get_quadrant() );
+                mGame.mTurn++;
+                mRotating = false;
+            }
+            else
+            {
+                b.set( move.mP, turntostate(mGame.mTurn) );
+                mGame.mWinning = b.winning_through( move.mP );
+                mPlaced = move.mP;
+                mRotating = true;
+                
+                // a winning placement ends the turn, and the game, without the rotation
+                if (mGame.mWinning!=empty) mGame.mTurn++;
+            }
+        }
+
+        // moves are only ever played from unfinished positions,
+        // so a winner can only have come from the move being undone
+        void Undo( const pentago::move& move )
+        {
+            if (mRotating)
+            {
+                if (mGame.mWinning!=empty) mGame.mTurn--;
+                mGame.mBoard.clear( move.mP );
+                mRotating = false;
+            }
+            else
+            {
+                move.mR.invert().apply( &mGame.mBoard );
+                mGame.mTurn--;
+                mPlaced = move.mP;
+                mRotating = true;
+            }
+            mGame.mWinning = empty;
+        }
+
+        // finishes the turn with a random rotation, then plays out as GameState
+        template< typename Rng >
+        int PlayRollout( Rng& rng )
+        {
+            if (mRotating && Finished()==false)
+                Apply( pentago::move( mPlaced, random_rotation( rng(8) ) ) );
+            return mGame.PlayRollout( rng );
+        }
+    };
+
+    // searches the split tree, then takes the rotation from below the chosen placement,
+    // searching on a little if the placement was never expanded
+    template< typename TimeoutFn >
+    pentago::move split_move( const GameState& game, TimeoutFn timeOut, const mcts::Config& config,
+        mcts::Arena< pentago::move >& arena, mcts::Stats< pentago::move >* stats=0 )
+    {
+        mcts::Tree< pentago::move, SplitGameState > tree( SplitGameState(game), config, arena );
+        tree.Search( timeOut, stats );
+        if (stats) tree.GetStats( stats );
+
+        const pentago::move placement = tree.BestMove();
+        tree.Advance( placement );
+        if (tree.Game().Finished())
+            return placement;
+
+        if (tree.Trials()==0)
+            tree.Search( IterationTimeOut(64) );
+        return tree.BestMove();
+    }
+}
+
+#endif
@@ -0,0 +1,274 @@
+// tablebase.cpp
+
+#include "tablebase.h"
+#include "gamestate.h"
+#include "mcts.h"
+
+#include <cassert>
+#include <cstdio>
+
+#include <string>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+namespace pentago
+{
+    static tablebase_result invert( tablebase_result r )
+    {
+        static const tablebase_result lut[4] = { tb_unknown, tb_loss, tb_draw, tb_win };
+        return lut[r];
+    }
+
+    // lower is better for the side to move
+    static int rank( tablebase_result r )
+    {
+        static const int lut[4] = { 3, 0, 1, 2 };
+        return lut[r];
+    }
+
+    tablebase_result terminal_result( const board& b, int turn )
+    {
+        const state w = b.winning();
+        if (w==turntostate(turn)) return tb_win;
+        if (w==turntostate(turn+1)) return tb_loss;
+        if (w==invalid) return tb_draw;
+        if (turn+1==6*6) return tb_draw;
+        return tb_unknown;
+    }
+
+    tablebase_result tablebase::probe( const board& b ) const
+    {
+        UInt symmetry;
+        const tablebase_record* r = mTable.find(b, &symmetry);
+        return r ? r->Result() : tb_unknown;
+    }
+
+    bool tablebase::best_move( const board& b, int turn, move* m, tablebase_result* r ) const
+    {
+        std::vector< pentago::move > moves;
+        all_moves(b, turn, &moves);
+
+        // a win is as good as it gets, whatever the moves not in the table lead to,
+        // anything less could be bettered by one of them
+        *r = tb_unknown;
+        bool unknown = false;
+        for (size_t i=0;i!=moves.size();++i)
+        {
+            board c = b;
+            moves[i].apply(&c, turn);
+
+            tablebase_result result = terminal_result(c, turn);
+            if (result==tb_unknown)
+            {
+                result = invert( probe(c) );
+                if (result==tb_unknown)
+                {
+                    unknown = true;
+                    continue;
+                }
+            }
+
+            if (rank(result) < rank(*r))
+            {
+                *r = result;
+                *m = moves[i];
+                if (result==tb_win) return true;
+            }
+        }
+        return unknown==false && *r!=tb_unknown;
+    }
+
+    std::vector< board > tablebase_seeds( const tablebase_settings& settings )
+    {
+        std::vector< board > result;
+        std::vector< uint64_t > seen;
+        mcts::Random rng;
+
+        const int turns = 6*6 - settings.mEmpties;
+        for (int attempts=0; (int)result.size()<settings.mSeeds && attempts!=settings.mSeeds*100; ++attempts)
+        {
+            GameState game;
+            while (game.Finished()==false && game.mTurn!=turns)
+                game = game.PlayMove( heuristic_move(game.mBoard, game.mTurn, rng) );
+
+            if (game.Finished()) continue;
+
+            UInt symmetry;
+            uint64_t key = canonical(game.mBoard, &symmetry);
+            if (std::find(seen.begin(), seen.end(), key)!=seen.end()) continue;
+
+            seen.push_back(key);
+            result.push_back(game.mBoard);
+        }
+        return result;
+    }
+
+    static std::string layer_path( const char* path, int empties )
+    {
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), ".layer%i", empties);
+        return std::string(path) + suffix;
+    }
+
+    template< typename T >
+    static bool write_all( const std::string& path, const std::vector< T >& v, const char* mode )
+    {
+        FILE* f = fopen(path.c_str(), mode);
+        if (!f) return false;
+        bool ok = v.empty() || fwrite(&v[0], sizeof(T), v.size(), f)==v.size();
+        return (fclose(f)==0) && ok;
+    }
+
+    template< typename T >
+    static bool read_all( const std::string& path, std::vector< T >* v )
+    {
+        v->clear();
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f) return false;
+
+        T buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, sizeof(T), 4096, f))!=0)
+            v->insert(v->end(), buffer, buffer+n);
+        fclose(f);
+        return true;
+    }
+
+    // runs fn(i) for i in [0,n) across the threads
+    template< typename Fn >
+    static void parallel_for( int threads, size_t n, Fn fn )
+    {
+        std::atomic< size_t > next(0);
+        std::vector< std::thread > workers;
+        for (int t=0;t!=threads;++t)
+        {
+            workers.push_back( std::thread( [&]() {
+                for (size_t i=next++; i<n; i=next++)
+                    fn(i);
+            } ) );
+        }
+        for (size_t t=0;t!=workers.size();++t)
+            workers[t].join();
+    }
+
+    uint64_t build_tablebase( const tablebase_settings& settings, const std::vector< board >& seeds,
+        const char* path )
+    {
+        int threads = settings.mThreads;
+        if (threads<=0) threads = std::max( 1u, std::thread::hardware_concurrency() );
+
+        const int top = settings.mEmpties;
+        if (top<1 || top>tablebase_max_empties) return 0;
+
+        // forward, the canonical non-terminal positions of each layer
+        std::vector< uint64_t > layer;
+        for (size_t i=0;i!=seeds.size();++i)
+        {
+            UInt symmetry;
+            layer.push_back( canonical(seeds[i], &symmetry) );
+        }
+        std::sort(layer.begin(), layer.end());
+        layer.erase(std::unique(layer.begin(), layer.end()), layer.end());
+
+        for (int empties=top; empties>0; --empties)
+        {
+            if (!write_all(layer_path(path, empties), layer, "wb")) return 0;
+            if (settings.mProgress)
+                fprintf(stderr, "%i empty: %i positions\n", empties, (int)layer.size());
+            if (empties==1) break;
+
+            const int turn = 6*6 - empties;
+            std::vector< uint64_t > next;
+            std::mutex lock;
+            parallel_for( threads, layer.size(), [&](size_t i) {
+                std::vector< pentago::move > moves;
+                std::vector< uint64_t > children;
+                const board b = unpack(layer[i]);
+                all_moves(b, turn, &moves);
+                for (size_t m=0;m!=moves.size();++m)
+                {
+                    board c = b;
+                    moves[m].apply(&c, turn);
+                    if (terminal_result(c, turn)!=tb_unknown) continue;
+
+                    UInt symmetry;
+                    children.push_back( canonical(c, &symmetry) );
+                }
+
+                std::lock_guard< std::mutex > guard(lock);
+                next.insert(next.end(), children.begin(), children.end());
+            } );
+
+            std::sort(next.begin(), next.end());
+            next.erase(std::unique(next.begin(), next.end()), next.end());
+            layer.swap(next);
+        }
+
+        // backward, each layer solved from the one below it
+        const std::string solvedPath = std::string(path) + ".solved";
+        remove(solvedPath.c_str());
+
+        std::vector< uint64_t > below;
+        std::vector< uint8_t > belowResults;
+        uint64_t solved = 0;
+        for (int empties=1; empties<=top; ++empties)
+        {
+            if (!read_all(layer_path(path, empties), &layer)) return 0;
+            remove(layer_path(path, empties).c_str());
+
+            const int turn = 6*6 - empties;
+            std::vector< uint8_t > results( layer.size() );
+            parallel_for( threads, layer.size(), [&](size_t i) {
+                std::vector< pentago::move > moves;
+                const board b = unpack(layer[i]);
+                all_moves(b, turn, &moves);
+
+                tablebase_result best = tb_unknown;
+                for (size_t m=0;m!=moves.size() && best!=tb_win;++m)
+                {
+                    board c = b;
+                    moves[m].apply(&c, turn);
+
+                    tablebase_result r = terminal_result(c, turn);
+                    if (r==tb_unknown)
+                    {
+                        UInt symmetry;
+                        const uint64_t key = canonical(c, &symmetry);
+                        std::vector< uint64_t >::const_iterator found =
+                            std::lower_bound(below.begin(), below.end(), key);
+                        assert( found!=below.end() && *found==key );
+                        r = invert( (tablebase_result)belowResults[found-below.begin()] );
+                    }
+
+                    if (rank(r) < rank(best)) best = r;
+                }
+                results[i] = best;
+            } );
+
+            std::vector< tablebase_record > records( layer.size() );
+            for (size_t i=0;i!=layer.size();++i)
+                records[i] = tablebase_record( layer[i], (tablebase_result)results[i] );
+            if (!write_all(solvedPath, records, "ab")) return 0;
+            solved += records.size();
+
+            if (settings.mProgress)
+                fprintf(stderr, "%i empty: solved\n", empties);
+
+            below.swap(layer);
+            belowResults.swap(results);
+        }
+
+        // and the solved layers, into one table
+        std::vector< tablebase_record > records;
+        if (!read_all(solvedPath, &records)) return 0;
+        remove(solvedPath.c_str());
+
+        table_builder< tablebase_record > builder;
+        for (size_t i=0;i!=records.size();++i)
+            builder.add(records[i]);
+
+        return builder.write(path) ? solved : 0;
+    }
+}
@@ -0,0 +1,127 @@
+// tablebase.h
+//
+// Endgame tablebase, the solved result of every position reachable
+// from a set of late game seed positions, with a few empty spaces left.
+//
+// Generation works a layer (number of empty spaces) at a time:
+// forward from the seeds, writing each layer's canonical positions to disk,
+// then backward from the fullest boards, solving each layer from the one below,
+// so only two layers are held in memory at once.
+
+#ifndef TABLEBASE_H_INCLUDED
+#define TABLEBASE_H_INCLUDED
+
+#include "pentago.h"
+#include "posdb.h"
+
+#include <vector>
+
+namespace pentago
+{
+    // for the side to move
+    enum tablebase_result
+    {
+        tb_unknown = 0,
+        tb_win = 1,
+        tb_draw = 2,
+        tb_loss = 3
+    };
+
+    // deepest layer worth probing for, generation beyond this is impractical
+    const int tablebase_max_empties = 8;
+
+    // 8 bytes per position, the result packed into the 4 bits above the 60 bit key
+    struct tablebase_record
+    {
+        uint64_t mV;
+
+        tablebase_record() : mV(0) { }
+
+        tablebase_record( uint64_t key, tablebase_result r )
+            : mV( key | ((uint64_t)r << 60) )
+        { }
+
+        uint64_t Key() const
+        {
+            return mV & ((1ull << 60)-1);
+        }
+
+        tablebase_result Result() const
+        {
+            return (tablebase_result)(mV >> 60);
+        }
+
+        static const char* Magic()
+        {
+            return "PTB1";
+        }
+
+        // a position only has the one result
+        void Merge( const tablebase_record& ) { }
+
+        bool operator<( const tablebase_record& rhs ) const
+        {
+            return Key() < rhs.Key();
+        }
+    };
+
+    class tablebase
+    {
+        public:
+            bool open( const char* path )
+            {
+                return mTable.open(path);
+            }
+
+            uint64_t size() const
+            {
+                return mTable.size();
+            }
+
+            // tb_unknown if the position isn't in the table
+            tablebase_result probe( const board& b ) const;
+
+            // the move with the best result for the side to move,
+            // false if any move leads somewhere unknown, unless another wins
+            bool best_move( const board& b, int turn, move* m, tablebase_result* r ) const;
+
+        private:
+            mapped_table< tablebase_record > mTable;
+    };
+
+    // the result of a finished game, for the player who made the last move,
+    // tb_unknown if the game isn't finished
+    tablebase_result terminal_result( const board& b, int turn );
+
+    struct tablebase_settings
+    {
+        tablebase_settings()
+            : mEmpties(6)
+            , mSeeds(16)
+            , mThreads(0)
+            , mProgress(true)
+        { }
+
+        // empty spaces in the seed positions, at most tablebase_max_empties
+        int mEmpties;
+
+        // number of seed positions to generate
+        int mSeeds;
+
+        // 0 for one per hardware thread
+        int mThreads;
+
+        // report each layer to stderr
+        bool mProgress;
+    };
+
+    // random heavy playouts stopped at mEmpties empty spaces
+    std::vector< board > tablebase_seeds( const tablebase_settings& settings );
+
+    // solves everything reachable from the seeds (which must all have mEmpties empty spaces),
+    // layers are streamed through temporary files beside path, returns the positions solved
+    uint64_t build_tablebase( const tablebase_settings& settings, const std::vector< board >& seeds,
+        const char* path );
+}
+
+#endif
@@ -0,0 +1,122 @@
+// threadpool.cpp
+
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace pentago
+{
+    static thread_local int worker_index = -1;
+
+    thread_pool::thread_pool( int threads )
+        : mQueued(0)
+        , mPending(0)
+        , mNext(0)
+        , mQuit(false)
+    {
+        if (threads<=0) threads = std::max( 1u, std::thread::hardware_concurrency() );
+
+        for (int t=0;t!=threads;++t)
+            mQueues.push_back( new queue );
+        for (int t=0;t!=threads;++t)
+            mThreads.push_back( std::thread( &thread_pool::run, this, t ) );
+    }
+
+    thread_pool::~thread_pool()
+    {
+        wait();
+        {
+            std::lock_guard< std::mutex > guard(mLock);
+            mQuit = true;
+        }
+        mWake.notify_all();
+
+        for (size_t t=0;t!=mThreads.size();++t)
+            mThreads[t].join();
+        for (size_t t=0;t!=mQueues.size();++t)
+            delete mQueues[t];
+    }
+
+    int thread_pool::worker()
+    {
+        return worker_index;
+    }
+
+    void thread_pool::submit( const task& t )
+    {
+        // worker_index belongs to whichever pool the thread works for
+        const int own = worker_index;
+        const size_t index = (own>=0 && own<size()) ? own : mNext++ % mQueues.size();
+
+        ++mPending;
+        {
+            std::lock_guard< std::mutex > guard(mQueues[index]->mLock);
+            mQueues[index]->mTasks.push_back(t);
+        }
+
+        // counted under the pool lock, so a worker can't miss it between checking and sleeping
+        {
+            std::lock_guard< std::mutex > guard(mLock);
+            ++mQueued;
+        }
+        mWake.notify_one();
+    }
+
+    void thread_pool::wait()
+    {
+        std::unique_lock< std::mutex > guard(mLock);
+        mIdle.wait( guard, [this]() { return mPending==0; } );
+    }
+
+    bool thread_pool::pop( int index, task* t )
+    {
+        const size_t n = mQueues.size();
+        for (size_t i=0;i!=n;++i)
+        {
+            queue& q = *mQueues[ (index+i) % n ];
+            std::lock_guard< std::mutex > guard(q.mLock);
+            if (q.mTasks.empty()) continue;
+
+            // newest of our own, oldest of anyone else's
+            if (i==0)
+            {
+                *t = q.mTasks.back();
+                q.mTasks.pop_back();
+            }
+            else
+            {
+                *t = q.mTasks.front();
+                q.mTasks.pop_front();
+            }
+            --mQueued;
+            return true;
+        }
+        return false;
+    }
+
+    void thread_pool::run( int index )
+    {
+        worker_index = index;
+
+        task t;
+        for (;;)
+        {
+            if (pop(index, &t))
+            {
+                t();
+                t = task();
+
+                if (--mPending==0)
+                {
+                    std::lock_guard< std::mutex > guard(mLock);
+                    mIdle.notify_all();
+                }
+                continue;
+            }
+
+            std::unique_lock< std::mutex > guard(mLock);
+            mWake.wait( guard, [this]() { return mQuit || mQueued>0; } );
+            if (mQuit && mQueued==0) return;
+        }
+    }
+}
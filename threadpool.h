@@ -0,0 +1,74 @@
+// threadpool.h
+//
+// Work stealing thread pool, one task queue per worker.
+// Workers take their own newest task first (it's the most likely to be in cache),
+// and when their queue is empty steal the oldest task from another's.
+
+#ifndef THREADPOOL_H_INCLUDED
+#define THREADPOOL_H_INCLUDED
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace pentago
+{
+    class thread_pool
+    {
+        public:
+            typedef std::function< void() > task;
+
+            // 0 for one per hardware thread
+            explicit thread_pool( int threads=0 );
+
+            // finishes every task submitted first
+            ~thread_pool();
+
+            // from a worker, onto its own queue, otherwise onto each queue in turn
+            void submit( const task& t );
+
+            // until every submitted task has finished
+            void wait();
+
+            int size() const
+            {
+                return (int)mThreads.size();
+            }
+
+            // of the calling thread, within whichever pool it works for, -1 if it isn't a worker
+            static int worker();
+
+        private:
+            // not copyable
+            thread_pool( const thread_pool& );
+            thread_pool& operator=( const thread_pool& );
+
+            struct queue
+            {
+                std::mutex mLock;
+                std::deque< task > mTasks;
+            };
+
+            void run( int index );
+            bool pop( int index, task* t );
+
+            std::vector< queue* > mQueues;
+            std::vector< std::thread > mThreads;
+
+            // tasks waiting in the queues, and waiting or running
+            std::atomic< int > mQueued;
+            std::atomic< int > mPending;
+            std::atomic< unsigned > mNext;
+
+            std::mutex mLock;
+            std::condition_variable mWake;
+            std::condition_variable mIdle;
+            bool mQuit;
+    };
+}
+
+#endif
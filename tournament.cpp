@@ -0,0 +1,236 @@
+// tournament.cpp
+
+#include "tournament.h"
+#include "proof.h"
+#include "alphabeta.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+namespace pentago
+{
+    bool engine_settings::parse( const char* str )
+    {
+        if (strcmp(str,"random")==0)
+        {
+            mKind = random_engine;
+            return true;
+        }
+
+        const char* args;
+        if (strncmp(str,"flat",4)==0)
+        {
+            mKind = flat_engine;
+            args = str+4;
+        }
+        else if (strncmp(str,"mcts",4)==0)
+        {
+            mKind = mcts_engine;
+            args = str+4;
+        }
+        else if (strncmp(str,"alphabeta",9)==0)
+        {
+            mKind = alphabeta_engine;
+            args = str+9;
+        }
+        else return false;
+
+        if (*args==':')
+        {
+            mPlayouts = atoi(++args);
+            while (*args && *args!=':') ++args;
+        }
+        while (*args==':')
+        {
+            const char* end = ++args;
+            while (*end && *end!=':') ++end;
+            const std::string option(args, end);
+            args = end;
+
+            if (option=="heavy")
+                mRollout = heuristic_rollout;
+            else if (option=="rave")
+                mConfig.mRave = default_rave;
+            else if (option=="split")
+                mSplit = true;
+            else if (option=="proof")
+                mProof = default_proof;
+            else if (option=="ucb1")
+                mConfig.mSelection = mcts::SelectUcb1;
+            else if (option=="tuned")
+                mConfig.mSelection = mcts::SelectUcb1Tuned;
+            else if (option=="puct")
+                mConfig.mSelection = mcts::SelectPuct;
+            else if (option=="visits")
+                mConfig.mFinal = mcts::FinalVisits;
+            else if (option=="ratio")
+                mConfig.mFinal = mcts::FinalRatio;
+            else if (option=="secure")
+                mConfig.mFinal = mcts::FinalSecure;
+            else return false;
+        }
+
+        return *args==0 && mPlayouts>0;
+    }
+
+    std::string engine_settings::name() const
+    {
+        char str[64];
+        switch (mKind)
+        {
+            case random_engine:
+                return "random";
+            case flat_engine:
+                snprintf(str, sizeof(str), "flat:%i", mPlayouts);
+                break;
+            case alphabeta_engine:
+                snprintf(str, sizeof(str), "alphabeta:%i", mPlayouts);
+                break;
+            case mcts_engine:
+            {
+                // only the choices that differ from the defaults
+                static const char* const selection[] = { ":ucb1", ":tuned", ":puct" };
+                static const char* const final[] = { ":visits", ":ratio", ":secure" };
+                const mcts::Config defaults = engine_settings().mConfig;
+                snprintf(str, sizeof(str), "mcts:%i%s%s%s%s%s%s", mPlayouts, mRollout==heuristic_rollout ? ":heavy" : "",
+                    mConfig.mRave>0 ? ":rave" : "", mSplit ? ":split" : "", mProof>0 ? ":proof" : "",
+                    mConfig.mSelection!=defaults.mSelection ? selection[mConfig.mSelection] : "",
+                    mConfig.mFinal!=defaults.mFinal ? final[mConfig.mFinal] : "");
+                break;
+            }
+        }
+        return str;
+    }
+
+    double tournament_result::score() const
+    {
+        const int n = games();
+        return n ? (mWins[0] + 0.5*mDraws) / n : 0.5;
+    }
+
+    double tournament_result::confidence() const
+    {
+        const int n = games();
+        if (n<2) return 0.5;
+
+        // from the variance of the individual game scores
+        const double s = score();
+        const double variance = ( mWins[0]*(1-s)*(1-s) + mWins[1]*s*s + mDraws*(0.5-s)*(0.5-s) ) / (n-1);
+        return 1.96 * sqrt(variance / n);
+    }
+
+    double tournament_result::elo() const
+    {
+        const double s = std::min( std::max( score(), 0.001 ), 0.999 );
+        return -400.0 * log10( 1.0/s - 1.0 );
+    }
+
+    pentago::move engine_move( const engine_settings& engine, const board& b, int turn, mcts::Random& rng )
+    {
+        switch (engine.mKind)
+        {
+            case random_engine:
+                return uniform_move(b, turn, rng);
+            case flat_engine:
+                return flat_move(b, turn, engine.mPlayouts, rng);
+            case alphabeta_engine:
+                return alphabeta_search::GetMove( GameState(b, turn), IterationTimeOut(engine.mPlayouts) );
+            case mcts_engine:
+                break;
+        }
+
+        pentago::move m;
+        if (engine.mProof>0 && proven_win(b, turn, engine.mProof, &m))
+            return m;
+
+        GameState game(b, turn);
+        game.mRollout = engine.mRollout;
+        game.mCutoff = engine.mCutoff;
+        if (engine.mSplit)
+        {
+            mcts::Arena< pentago::move > arena( engine.mConfig.mNodeBudget );
+            return split_move( game, IterationTimeOut(engine.mPlayouts), engine.mConfig, arena );
+        }
+        return mcts::Node< pentago::move >::GetMove( game, IterationTimeOut(engine.mPlayouts), engine.mConfig );
+    }
+
+    // the winner, as GameState::GetWinner
+    static int play_game( const tournament_settings& settings, int game, game_record* record )
+    {
+        mcts::Random rng( (game+1) * 2654435761u );
+        GameState state;
+
+        // engine 0 is white in the even games
+        const int first = game & 1;
+        while (state.Finished()==false)
+        {
+            const engine_settings& engine = settings.mEngines[ first ^ state.GetCurrentPlayer() ];
+            pentago::move m = (state.mTurn < settings.mRandomPlies)
+                ? uniform_move(state.mBoard, state.mTurn, rng)
+                : engine_move(engine, state.mBoard, state.mTurn, rng);
+            state = state.PlayMove(m);
+            record->mMoves.push_back(m);
+        }
+
+        record->mWinner = state.GetWinner();
+        return record->mWinner;
+    }
+
+    tournament_result run_tournament( const tournament_settings& settings )
+    {
+        int threads = settings.mThreads;
+        if (threads<=0) threads = std::max( 1u, std::thread::hardware_concurrency() );
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        tournament_result result;
+        std::mutex lock;
+        std::atomic<int> next(0);
+        std::vector< std::thread > workers;
+        for (int t=0;t!=threads;++t)
+        {
+            workers.push_back( std::thread( [&]() {
+                for (int g=next++; g<settings.mGames; g=next++)
+                {
+                    game_record record;
+                    const int winner = play_game(settings, g, &record);
+                    if (settings.mLog) settings.mLog->append(record);
+
+                    std::lock_guard< std::mutex > guard(lock);
+                    if (winner==0 || winner==1)
+                        result.mWins[ winner ^ (g&1) ]++;
+                    else
+                        result.mDraws++;
+
+                    if (settings.mProgress && result.games()%100==0)
+                        fprintf(stderr, "%i games, score %.3f +/- %.3f\n",
+                            result.games(), result.score(), result.confidence());
+                }
+            } ) );
+        }
+        for (size_t t=0;t!=workers.size();++t)
+            workers[t].join();
+
+        result.mSeconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+        return result;
+    }
+
+    void report( const tournament_settings& settings, const tournament_result& result, FILE* out )
+    {
+        fprintf(out, "%s vs %s\n", settings.mEngines[0].name().c_str(), settings.mEngines[1].name().c_str());
+        fprintf(out, "games %i: %i wins, %i losses, %i draws\n",
+            result.games(), result.mWins[0], result.mWins[1], result.mDraws);
+        fprintf(out, "score %.3f +/- %.3f (95%%), elo %+.0f\n",
+            result.score(), result.confidence(), result.elo());
+        fprintf(out, "%.1f seconds, %.2f games/sec\n",
+            result.mSeconds, result.mSeconds>0 ? result.games()/result.mSeconds : 0.0);
+    }
+}
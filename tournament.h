@@ -0,0 +1,137 @@
+// tournament.h
+//
+// Headless matches between two engines, many games in parallel,
+// for measuring whether a change makes the program stronger per second of search.
+
+#ifndef TOURNAMENT_H_INCLUDED
+#define TOURNAMENT_H_INCLUDED
+
+#include "pentago.h"
+#include "gamestate.h"
+#include "splitstate.h"
+#include "gamerecord.h"
+#include "mcts.h"
+
+#include <cstdio>
+
+#include <string>
+
+namespace pentago
+{
+    enum engine_kind
+    {
+        random_engine,
+        flat_engine,
+        mcts_engine,
+        alphabeta_engine
+    };
+
+    struct engine_settings
+    {
+        engine_settings()
+            : mKind(mcts_engine)
+            , mPlayouts(2000)
+            , mRollout(uniform_rollout)
+            , mCutoff(0)
+            , mSplit(false)
+            , mProof(0)
+            , mThreads(1)
+        {
+            // guided by the heavy playout policy's weights, much stronger than UCB1 for pentago
+            mConfig.mSelection = mcts::SelectPuct;
+        }
+
+        engine_kind mKind;
+
+        // mcts iterations per move, flat playouts per possible move, or alpha-beta nodes per move
+        int mPlayouts;
+
+        rollout_policy mRollout;
+        int mCutoff;
+        mcts::Config mConfig;
+
+        // search placements and rotations as separate levels of the tree (see SplitGameState)
+        bool mSplit;
+
+        // proof-number search expansions spent looking for a forced win before each mcts search,
+        // 0 for none (see proof_search)
+        int mProof;
+
+        // threads each alpha-beta search runs on (see alphabeta_search), 0 for one per hardware thread,
+        // mcts searches, and tournaments, are parallel across games instead
+        int mThreads;
+
+        // from "random", "flat:N", "alphabeta:N", or "mcts:N" followed by any of
+        // ":heavy", ":rave", ":split", ":proof", the selection ":ucb1", ":tuned" or ":puct",
+        // and the final move rule ":visits", ":ratio" or ":secure",
+        // anything not given is left as it was
+        static const int default_rave = 50;
+        static const int default_proof = 1000;
+        bool parse( const char* str );
+        std::string name() const;
+    };
+
+    struct tournament_settings
+    {
+        tournament_settings()
+            : mGames(100)
+            , mThreads(0)
+            , mRandomPlies(4)
+            , mProgress(true)
+            , mLog(0)
+        { }
+
+        // engine 0 plays white in the even games, black in the odd
+        engine_settings mEngines[2];
+
+        int mGames;
+
+        // 0 for one per hardware thread
+        int mThreads;
+
+        // uniform random moves opening each game, so the games differ
+        int mRandomPlies;
+
+        // report every 100 games to stderr
+        bool mProgress;
+
+        // when set, every game is recorded
+        game_writer* mLog;
+    };
+
+    struct tournament_result
+    {
+        tournament_result()
+            : mDraws(0)
+            , mSeconds(0)
+        {
+            mWins[0] = mWins[1] = 0;
+        }
+
+        int mWins[2];
+        int mDraws;
+        double mSeconds;
+
+        int games() const
+        {
+            return mWins[0] + mWins[1] + mDraws;
+        }
+
+        // engine 0's share of the points, draws counting a half,
+        // and the half width of its 95% confidence interval
+        double score() const;
+        double confidence() const;
+
+        // engine 0's strength relative to engine 1
+        double elo() const;
+    };
+
+    // thread safe, given a generator per thread
+    pentago::move engine_move( const engine_settings& engine, const board& b, int turn, mcts::Random& rng );
+
+    tournament_result run_tournament( const tournament_settings& settings );
+
+    void report( const tournament_settings& settings, const tournament_result& result, FILE* out );
+}
+
+#endif
@@ -0,0 +1,142 @@
+// tune.cpp
+
+#include "tune.h"
+#include "gamestate.h"
+
+#include <cmath>
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+namespace pentago
+{
+    static const char* feature_names[feature_count] = {
+        "open_2",
+        "open_3",
+        "open_4",
+        "blocked_2",
+        "blocked_3",
+        "blocked_4",
+    };
+    
+    static void self_play( const tune_settings& settings, int game, std::vector< tune_sample >* samples )
+    {
+        mcts::Random rng( (game+1) * 2654435761u );
+        GameState state;
+        std::vector< tune_sample > positions;
+        
+        while (state.Finished()==false)
+        {
+            pentago::move m = (state.mTurn < settings.mRandomPlies)
+                ? uniform_move(state.mBoard, state.mTurn, rng)
+                : mcts::Node< pentago::move >::GetMove( state, IterationTimeOut(settings.mPlayouts), settings.mConfig );
+            state = state.PlayMove(m);
+            
+            if (state.Finished()) break;
+            
+            const line_counts counts(state.mBoard);
+            tune_sample s;
+            for (int f=0;f!=feature_count;++f)
+                s.mX[f] = counts.features(white, (feature)f) - counts.features(black, (feature)f);
+            positions.push_back(s);
+        }
+        
+        const int winner = state.GetWinner();
+        const float result = (winner==0) ? 1.0f : (winner==1) ? 0.0f : 0.5f;
+        for (size_t i=0;i!=positions.size();++i)
+        {
+            positions[i].mResult = result;
+            samples->push_back(positions[i]);
+        }
+    }
+    
+    double log_loss( const std::vector< tune_sample >& samples, const double* w )
+    {
+        double total = 0;
+        for (size_t i=0;i!=samples.size();++i)
+        {
+            double z = 0;
+            for (int f=0;f!=feature_count;++f)
+                z += w[f] * samples[i].mX[f];
+            const double p = std::min( std::max( 1.0/(1.0+exp(-z)), 1e-9 ), 1.0-1e-9 );
+            const double y = samples[i].mResult;
+            total -= y*log(p) + (1-y)*log(1-p);
+        }
+        return total / samples.size();
+    }
+    
+    void fit_weights( const std::vector< tune_sample >& samples, int epochs, double* w )
+    {
+        if (samples.empty()) return;
+        
+        const double rate = 0.05;
+        for (int e=0;e!=epochs;++e)
+        {
+            double grad[feature_count] = { 0 };
+            for (size_t i=0;i!=samples.size();++i)
+            {
+                double z = 0;
+                for (int f=0;f!=feature_count;++f)
+                    z += w[f] * samples[i].mX[f];
+                const double g = 1.0/(1.0+exp(-z)) - samples[i].mResult;
+                for (int f=0;f!=feature_count;++f)
+                    grad[f] += g * samples[i].mX[f];
+            }
+            for (int f=0;f!=feature_count;++f)
+                w[f] -= rate * grad[f] / samples.size();
+        }
+    }
+    
+    void tune( const tune_settings& settings, FILE* out )
+    {
+        int threads = settings.mThreads;
+        if (threads<=0) threads = std::max( 1u, std::thread::hardware_concurrency() );
+        
+        // generate the self-play positions
+        std::vector< tune_sample > samples;
+        std::mutex lock;
+        std::atomic<int> next(0);
+        std::vector< std::thread > workers;
+        for (int t=0;t!=threads;++t)
+        {
+            workers.push_back( std::thread( [&]() {
+                std::vector< tune_sample > local;
+                for (int g=next++; g<settings.mGames; g=next++)
+                {
+                    local.clear();
+                    self_play(settings, g, &local);
+                    
+                    std::lock_guard< std::mutex > guard(lock);
+                    samples.insert(samples.end(), local.begin(), local.end());
+                    if ((g+1)%100==0) fprintf(stderr, "%i games, %i positions\n", g+1, (int)samples.size());
+                }
+            } ) );
+        }
+        for (size_t t=0;t!=workers.size();++t)
+            workers[t].join();
+        
+        if (samples.empty()) return;
+        
+        // fit the weights, in logits, starting from the current table
+        double w[feature_count];
+        for (int f=0;f!=feature_count;++f)
+            w[f] = feature_weights[f] / 100.0;
+        
+        fprintf(stderr, "log loss before: %f\n", log_loss(samples, w));
+        
+        fit_weights(samples, settings.mEpochs, w);
+        
+        fprintf(stderr, "log loss after: %f\n", log_loss(samples, w));
+        
+        fprintf(out, "// eval_weights.h\n");
+        fprintf(out, "//\n");
+        fprintf(out, "// Feature weights for evaluate.cpp, in 1/100ths of a logit of white's winning chances.\n");
+        fprintf(out, "// Generated by \"pentago tune games=%i playouts=%i\" from %i positions.\n",
+            settings.mGames, settings.mPlayouts, (int)samples.size());
+        fprintf(out, "\n");
+        for (int f=0;f!=feature_count;++f)
+            fprintf(out, "%i, // %s\n", (int)floor(w[f]*100 + 0.5), feature_names[f]);
+    }
+}
@@ -0,0 +1,63 @@
+// tune.h
+//
+// Offline tuning of the static evaluation feature weights,
+// by logistic regression over positions from self-play games.
+
+#ifndef TUNE_H_INCLUDED
+#define TUNE_H_INCLUDED
+
+#include "mcts.h"
+#include "evaluate.h"
+
+#include <cstdio>
+#include <cstdint>
+
+#include <vector>
+
+namespace pentago
+{
+    struct tune_settings
+    {
+        tune_settings()
+            : mGames(1000)
+            , mPlayouts(2000)
+            , mRandomPlies(4)
+            , mEpochs(2000)
+            , mThreads(0)
+        { }
+        
+        // self-play games to generate, and the mcts iterations per move
+        int mGames;
+        int mPlayouts;
+        
+        // uniform random moves opening each game, so the games differ
+        int mRandomPlies;
+        
+        // gradient descent passes over the positions
+        int mEpochs;
+        
+        // 0 for one per hardware thread
+        int mThreads;
+        
+        mcts::Config mConfig;
+    };
+    
+    // feature differences (white - black) for one position,
+    // and the eventual result for white, 1 win, 0.5 draw, 0 loss
+    struct tune_sample
+    {
+        int16_t mX[feature_count];
+        float mResult;
+    };
+    
+    // the mean log loss of predicting each sample's result from its features, with weights w in logits
+    double log_loss( const std::vector< tune_sample >& samples, const double* w );
+    
+    // gradient descent on the log loss, for epochs passes over the samples, from the weights w
+    void fit_weights( const std::vector< tune_sample >& samples, int epochs, double* w );
+    
+    // writes an eval_weights.h table to out, progress to stderr
+    void tune( const tune_settings& settings, FILE* out );
+}
+
+#endif